@@ -0,0 +1,542 @@
+// Micro-benchmarks for the codec kernels (FrameCodec::encodeInto and
+// encode, FrameDecoder::push and decode, their compile-time
+// BasicFrameCodec/BasicFrameDecoder counterparts, crc16_ccitt) over payloads
+// of several sizes and escape densities. Reports ns per payload byte and, where
+// perf_event_open is permitted, cycles, instructions and cache misses per
+// payload byte. Results can be written as CSV and gated against a saved
+// baseline:
+//
+//     codec_bench --out baseline.csv --runs 3
+//     codec_bench --baseline baseline.csv --runs 3
+//
+// Exits 1 when a case regressed by more than the tolerance. The default
+// metric is instructions when the counters are available and ns otherwise;
+// ns gets a looser default tolerance because wall time is far noisier.
+
+#include "basic_frame_codec.h"
+#include "crc.h"
+#include "link_layer.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using namespace spi_eak;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kRepetitions = 5;
+constexpr int kRetries = 3; // re-measurements of a case that looks regressed
+
+// Keeps the compiler from discarding results or hoisting work out of loops.
+inline void clobber(const void* ptr) {
+    asm volatile("" : : "g"(ptr) : "memory");
+}
+
+/**
+ * cycles, instructions and cache-misses for the calling thread, opened as
+ * one group so they cover the same interval. available() is false when the
+ * kernel refuses (no PMU in a VM, perf_event_paranoid, seccomp).
+ */
+class PerfCounters {
+public:
+    struct Sample {
+        double cycles = 0.0;
+        double instructions = 0.0;
+        double cache_misses = 0.0;
+    };
+
+    PerfCounters() {
+        const uint64_t events[3] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                    PERF_COUNT_HW_CACHE_MISSES};
+        for (int idx = 0; idx < 3; ++idx) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = events[idx];
+            attr.disabled = idx == 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            const long fd = syscall(SYS_perf_event_open, &attr, 0, -1, idx == 0 ? -1 : fds_[0], 0);
+            if (fd < 0) {
+                error_ = std::error_code(errno, std::generic_category()).message();
+                close();
+                return;
+            }
+            fds_[idx] = static_cast<int>(fd);
+        }
+    }
+
+    ~PerfCounters() { close(); }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    [[nodiscard]] bool available() const noexcept { return fds_[0] >= 0; }
+    [[nodiscard]] const std::string& error() const noexcept { return error_; }
+
+    void start() {
+        if (available()) {
+            ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+    }
+
+    Sample stop() {
+        Sample sample;
+        if (!available()) {
+            return sample;
+        }
+        ioctl(fds_[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        uint64_t data[3 + 3] = {};
+        if (::read(fds_[0], data, sizeof(data)) < static_cast<ssize_t>(sizeof(data))) {
+            return sample;
+        }
+        // data = {nr, time_enabled, time_running, values...}; scale if multiplexed.
+        const double scale = data[2] ? static_cast<double>(data[1]) / static_cast<double>(data[2]) : 0.0;
+        sample.cycles = static_cast<double>(data[3]) * scale;
+        sample.instructions = static_cast<double>(data[4]) * scale;
+        sample.cache_misses = static_cast<double>(data[5]) * scale;
+        return sample;
+    }
+
+private:
+    void close() {
+        for (int& fd : fds_) {
+            if (fd >= 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+    }
+
+    int fds_[3] = {-1, -1, -1};
+    std::string error_;
+};
+
+struct Measurement {
+    std::string kernel;
+    std::string corpus;
+    std::size_t bytes = 0;
+    double ns_per_byte = 0.0;
+    double cycles_per_byte = NAN; // NaN when counters are unavailable
+    double instructions_per_byte = NAN;
+    double cache_misses_per_byte = NAN;
+
+    [[nodiscard]] std::string key() const { return kernel + "/" + corpus + "/" + std::to_string(bytes); }
+
+    [[nodiscard]] double metric(const std::string& name) const {
+        if (name == "cycles") {
+            return cycles_per_byte;
+        }
+        if (name == "instructions") {
+            return instructions_per_byte;
+        }
+        return ns_per_byte;
+    }
+};
+
+std::vector<uint8_t> makePayload(const std::string& density, std::size_t size) {
+    std::mt19937 rng(static_cast<uint32_t>(size));
+    std::vector<uint8_t> payload(size);
+    const FrameCodec::Parameters params;
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        if (density == "all-sentinel") {
+            payload[idx] = idx % 2 ? params.start_byte : params.escape_byte;
+            continue;
+        }
+        uint8_t byte = static_cast<uint8_t>(rng());
+        if (density == "no-escape") {
+            while (byte == params.start_byte || byte == params.stop_byte || byte == params.escape_byte) {
+                byte = static_cast<uint8_t>(rng());
+            }
+        }
+        payload[idx] = byte;
+    }
+    return payload;
+}
+
+// Runs `body` (one pass over the payload) in batches sized to take about
+// min_seconds / kRepetitions each, keeping the lowest value of each metric
+// across repetitions.
+Measurement measure(PerfCounters& counters, std::size_t bytes, double min_seconds, const std::function<void()>& body) {
+    std::size_t iterations = 1;
+    const auto budget = std::chrono::duration<double>(min_seconds / kRepetitions);
+    for (;;) {
+        const auto started = Clock::now();
+        for (std::size_t idx = 0; idx < iterations; ++idx) {
+            body();
+        }
+        const auto elapsed = Clock::now() - started;
+        if (elapsed >= budget || iterations >= (std::size_t{1} << 30)) {
+            break;
+        }
+        const double ratio = budget / std::max(elapsed, std::chrono::duration_cast<Clock::duration>(
+                                                            std::chrono::nanoseconds(100)));
+        iterations = static_cast<std::size_t>(static_cast<double>(iterations) * std::min(ratio * 1.2, 100.0)) + 1;
+    }
+
+    Measurement best;
+    best.ns_per_byte = INFINITY;
+    for (int rep = 0; rep < kRepetitions; ++rep) {
+        counters.start();
+        const auto started = Clock::now();
+        for (std::size_t idx = 0; idx < iterations; ++idx) {
+            body();
+        }
+        const auto elapsed = Clock::now() - started;
+        const PerfCounters::Sample sample = counters.stop();
+
+        const double total_bytes = static_cast<double>(iterations) * static_cast<double>(bytes);
+        const double ns = std::chrono::duration<double, std::nano>(elapsed).count() / total_bytes;
+        best.ns_per_byte = std::min(best.ns_per_byte, ns);
+        if (counters.available()) {
+            best.cycles_per_byte = std::fmin(best.cycles_per_byte, sample.cycles / total_bytes);
+            best.instructions_per_byte = std::fmin(best.instructions_per_byte, sample.instructions / total_bytes);
+            best.cache_misses_per_byte = std::fmin(best.cache_misses_per_byte, sample.cache_misses / total_bytes);
+        }
+    }
+    return best;
+}
+
+// Folds another run into `best`, case by case and metric by metric, so a
+// burst of noise that hits one run does not decide the result.
+void keepBest(std::vector<Measurement>& best, const std::vector<Measurement>& run) {
+    for (const Measurement& again : run) {
+        for (Measurement& current : best) {
+            if (current.key() != again.key()) {
+                continue;
+            }
+            current.ns_per_byte = std::min(current.ns_per_byte, again.ns_per_byte);
+            current.cycles_per_byte = std::fmin(current.cycles_per_byte, again.cycles_per_byte);
+            current.instructions_per_byte = std::fmin(current.instructions_per_byte, again.instructions_per_byte);
+            current.cache_misses_per_byte = std::fmin(current.cache_misses_per_byte, again.cache_misses_per_byte);
+            break;
+        }
+    }
+}
+
+// Measures every case, or only the keys in `only` when it is given.
+std::vector<Measurement> runAll(PerfCounters& counters,
+                                double min_seconds,
+                                const std::set<std::string>* only = nullptr) {
+    // Same sentinels and checksum as the default runtime parameters, so the
+    // basic-* rows compare like for like.
+    using Codec = BasicFrameCodec<0x7E, 0x7F, 0x7D, Crc16Policy>;
+    using Decoder = BasicFrameDecoder<0x7E, 0x7F, 0x7D, Crc16Policy>;
+
+    std::vector<Measurement> results;
+    const FrameCodec::Parameters params;
+    FrameDecoder::Options options;
+    options.params = params;
+    options.max_frame_bytes = 8192;
+
+    for (const char* density : {"no-escape", "random", "all-sentinel"}) {
+        for (std::size_t size : {16u, 64u, 256u, 1024u, 4096u}) {
+            const std::vector<uint8_t> payload = makePayload(density, size);
+            std::vector<uint8_t> frame(FrameCodec::maxEncodedSize(size, params));
+            frame.resize(FrameCodec::encodeInto(payload.data(), size, frame.data(), frame.size(), params).bytes_written);
+
+            std::vector<uint8_t> scratch(FrameCodec::maxEncodedSize(size, params));
+            FrameDecoder decoder(options);
+            Decoder basic_decoder(options.max_frame_bytes);
+            std::vector<uint8_t> out;
+            out.reserve(options.max_frame_bytes);
+            std::size_t frames = 0;
+            const FrameDecoder::ResultCallback count = [&](const FrameDecoder::Result& result) {
+                frames += result.frame_ready ? 1 : 0;
+            };
+
+            const std::pair<const char*, std::function<void()>> kernels[] = {
+                {"encode",
+                 [&]() {
+                     FrameCodec::encodeInto(payload.data(), size, scratch.data(), scratch.size(), params);
+                     clobber(scratch.data());
+                 }},
+                {"encode-vec",
+                 [&]() {
+                     const FrameCodec::Result encoded = FrameCodec::encode(payload, params);
+                     clobber(encoded.frame.data());
+                 }},
+                {"basic-encode",
+                 [&]() {
+                     Codec::encodeInto(payload.data(), size, scratch.data(), scratch.size());
+                     clobber(scratch.data());
+                 }},
+                {"basic-encode-vec",
+                 [&]() {
+                     const FrameCodec::Result encoded = Codec::encode(payload);
+                     clobber(encoded.frame.data());
+                 }},
+                {"push",
+                 [&]() {
+                     for (uint8_t byte : frame) {
+                         decoder.push(byte, out);
+                     }
+                     clobber(out.data());
+                 }},
+                {"decode",
+                 [&]() {
+                     decoder.decode(frame.data(), frame.size(), out, count);
+                     clobber(out.data());
+                 }},
+                {"basic-decode",
+                 [&]() {
+                     basic_decoder.decode(frame.data(), frame.size(), out, count);
+                     clobber(out.data());
+                 }},
+                {"crc16",
+                 [&]() {
+                     const uint16_t crc = crc::crc16_ccitt(payload.data(), size);
+                     clobber(&crc);
+                 }},
+            };
+
+            for (const auto& kernel : kernels) {
+                Measurement result;
+                result.kernel = kernel.first;
+                result.corpus = density;
+                result.bytes = size;
+                if (only && only->count(result.key()) == 0) {
+                    continue;
+                }
+                const Measurement timed = measure(counters, size, min_seconds, kernel.second);
+                result.ns_per_byte = timed.ns_per_byte;
+                result.cycles_per_byte = timed.cycles_per_byte;
+                result.instructions_per_byte = timed.instructions_per_byte;
+                result.cache_misses_per_byte = timed.cache_misses_per_byte;
+                results.push_back(result);
+            }
+            if (out != payload) {
+                std::fprintf(stderr, "decode mismatch for %s/%zu\n", density, size);
+            }
+        }
+    }
+    return results;
+}
+
+std::string formatValue(double value, const char* missing = "") {
+    if (std::isnan(value)) {
+        return missing;
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.4f", value);
+    return buffer;
+}
+
+bool writeCsv(const std::string& path, const std::vector<Measurement>& results) {
+    std::ofstream out(path);
+    out << "kernel,corpus,bytes,ns_per_byte,cycles_per_byte,instructions_per_byte,cache_misses_per_byte\n";
+    for (const Measurement& result : results) {
+        out << result.kernel << ',' << result.corpus << ',' << result.bytes << ',' << formatValue(result.ns_per_byte)
+            << ',' << formatValue(result.cycles_per_byte) << ',' << formatValue(result.instructions_per_byte) << ','
+            << formatValue(result.cache_misses_per_byte) << '\n';
+    }
+    return static_cast<bool>(out);
+}
+
+double parseValue(const std::string& field) {
+    return field.empty() ? NAN : std::strtod(field.c_str(), nullptr);
+}
+
+bool readCsv(const std::string& path, std::map<std::string, Measurement>& baseline) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::string line;
+    std::getline(in, line); // header
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, ',')) {
+            fields.push_back(field);
+        }
+        fields.resize(7);
+        Measurement result;
+        result.kernel = fields[0];
+        result.corpus = fields[1];
+        result.bytes = static_cast<std::size_t>(std::strtoull(fields[2].c_str(), nullptr, 10));
+        result.ns_per_byte = parseValue(fields[3]);
+        result.cycles_per_byte = parseValue(fields[4]);
+        result.instructions_per_byte = parseValue(fields[5]);
+        result.cache_misses_per_byte = parseValue(fields[6]);
+        baseline[result.key()] = result;
+    }
+    return true;
+}
+
+bool regressed(const Measurement& before, const Measurement& now, const std::string& metric, double tolerance) {
+    const double was = before.metric(metric);
+    const double is = now.metric(metric);
+    return !std::isnan(was) && !std::isnan(is) && was > 0.0 && is / was > 1.0 + tolerance;
+}
+
+// Keys of the cases slower than baseline * (1 + tolerance).
+std::set<std::string> regressedKeys(const std::vector<Measurement>& results,
+                                    const std::map<std::string, Measurement>& baseline,
+                                    const std::string& metric,
+                                    double tolerance) {
+    std::set<std::string> keys;
+    for (const Measurement& result : results) {
+        const auto found = baseline.find(result.key());
+        if (found != baseline.end() && regressed(found->second, result, metric, tolerance)) {
+            keys.insert(result.key());
+        }
+    }
+    return keys;
+}
+
+// Returns the number of cases slower than baseline * (1 + tolerance).
+int compare(const std::vector<Measurement>& results,
+            const std::map<std::string, Measurement>& baseline,
+            const std::string& metric,
+            double tolerance) {
+    int regressions = 0;
+    int improvements = 0;
+    int compared = 0;
+    for (const Measurement& result : results) {
+        const auto found = baseline.find(result.key());
+        if (found == baseline.end()) {
+            std::printf("  %-28s not in baseline\n", result.key().c_str());
+            continue;
+        }
+        const double before = found->second.metric(metric);
+        const double now = result.metric(metric);
+        if (std::isnan(before) || std::isnan(now) || before <= 0.0) {
+            continue;
+        }
+        ++compared;
+        const double ratio = now / before;
+        if (ratio > 1.0 + tolerance) {
+            ++regressions;
+            std::printf("  REGRESSION %-28s %s/byte %.4f -> %.4f (%+.1f%%)\n", result.key().c_str(), metric.c_str(),
+                        before, now, (ratio - 1.0) * 100.0);
+        } else if (ratio < 1.0 - tolerance) {
+            ++improvements;
+        }
+    }
+    std::printf("compared %d cases on %s/byte: %d regressed, %d improved beyond %.1f%%\n", compared, metric.c_str(),
+                regressions, improvements, tolerance * 100.0);
+    if (compared == 0) {
+        std::printf("nothing comparable: is the metric available in both runs?\n");
+    }
+    return regressions;
+}
+
+void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--out FILE] [--baseline FILE] [--tolerance FRACTION]\n"
+                 "          [--metric auto|ns|cycles|instructions] [--min-time SECONDS] [--runs N]\n",
+                 argv0);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string out_path;
+    std::string baseline_path;
+    std::string metric = "auto";
+    double tolerance = NAN; // 0.10 for counters, 0.25 for ns unless given
+    double min_seconds = 0.05;
+    int runs = 1;
+
+    for (int idx = 1; idx < argc; ++idx) {
+        const std::string arg = argv[idx];
+        const bool has_value = idx + 1 < argc;
+        if (arg == "--out" && has_value) {
+            out_path = argv[++idx];
+        } else if (arg == "--baseline" && has_value) {
+            baseline_path = argv[++idx];
+        } else if (arg == "--tolerance" && has_value) {
+            tolerance = std::strtod(argv[++idx], nullptr);
+        } else if (arg == "--metric" && has_value) {
+            metric = argv[++idx];
+        } else if (arg == "--min-time" && has_value) {
+            min_seconds = std::strtod(argv[++idx], nullptr);
+        } else if (arg == "--runs" && has_value) {
+            runs = std::atoi(argv[++idx]);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if ((metric != "auto" && metric != "ns" && metric != "cycles" && metric != "instructions") || runs < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::map<std::string, Measurement> baseline;
+    if (!baseline_path.empty() && !readCsv(baseline_path, baseline)) {
+        std::fprintf(stderr, "cannot read baseline '%s'\n", baseline_path.c_str());
+        return 2;
+    }
+
+    PerfCounters counters;
+    if (!counters.available()) {
+        std::printf("hardware counters unavailable (%s); reporting time only\n", counters.error().c_str());
+    }
+    if (metric == "auto") {
+        metric = counters.available() ? "instructions" : "ns";
+        if (!baseline_path.empty() && metric == "ns") {
+            std::printf("gating on wall time; it drifts with machine load, so prefer a host with counters\n");
+        }
+    }
+    if (std::isnan(tolerance)) {
+        tolerance = metric == "ns" ? 0.25 : 0.10;
+    }
+
+    std::vector<Measurement> results = runAll(counters, min_seconds);
+    for (int run = 1; run < runs; ++run) {
+        keepBest(results, runAll(counters, min_seconds));
+    }
+    // A real regression survives being measured again; a noise spike rarely
+    // does, so suspects get a few more tries before they are reported.
+    for (int retry = 0; retry < kRetries && !baseline.empty(); ++retry) {
+        const std::set<std::string> suspects = regressedKeys(results, baseline, metric, tolerance);
+        if (suspects.empty()) {
+            break;
+        }
+        keepBest(results, runAll(counters, min_seconds, &suspects));
+    }
+    std::printf("%-16s %-13s %6s %9s %9s %9s %9s\n", "kernel", "corpus", "bytes", "ns/B", "cyc/B", "ins/B",
+                "miss/B");
+    for (const Measurement& result : results) {
+        std::printf("%-16s %-13s %6zu %9.3f %9s %9s %9s\n", result.kernel.c_str(), result.corpus.c_str(), result.bytes,
+                    result.ns_per_byte, formatValue(result.cycles_per_byte, "-").c_str(),
+                    formatValue(result.instructions_per_byte, "-").c_str(),
+                    formatValue(result.cache_misses_per_byte, "-").c_str());
+    }
+
+    if (!out_path.empty() && !writeCsv(out_path, results)) {
+        std::fprintf(stderr, "cannot write '%s'\n", out_path.c_str());
+        return 2;
+    }
+    if (!baseline_path.empty()) {
+        return compare(results, baseline, metric, tolerance) > 0 ? 1 : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+// Compares SLIP-style escaping with COBS framing: wire overhead, encode and
+// decode throughput over random and adversarial payloads.
+
+#include "link_layer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace spi_eak;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double kSecondsPerCase = 0.2;
+
+struct Corpus {
+    const char* name;
+    std::vector<uint8_t> payload;
+};
+
+std::vector<Corpus> corpora(std::size_t size) {
+    std::mt19937 rng(42);
+    std::vector<Corpus> result;
+
+    Corpus random{"random", std::vector<uint8_t>(size)};
+    for (auto& byte : random.payload) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    result.push_back(random);
+
+    // Worst case for SLIP: every byte is a sentinel and doubles.
+    Corpus sentinels{"all-sentinel", std::vector<uint8_t>(size)};
+    for (std::size_t idx = 0; idx < size; ++idx) {
+        sentinels.payload[idx] = idx % 2 ? 0x7E : 0x7D;
+    }
+    result.push_back(sentinels);
+
+    // Worst case for COBS: no zeros, so every 254 bytes cost a code byte.
+    result.push_back({"no-zero", std::vector<uint8_t>(size, 0xFF)});
+    result.push_back({"all-zero", std::vector<uint8_t>(size, 0x00)});
+    return result;
+}
+
+template <typename Fn>
+double bytesPerSecond(std::size_t bytes_per_call, Fn&& fn) {
+    std::size_t calls = 0;
+    const auto start = Clock::now();
+    auto elapsed = Clock::duration::zero();
+    do {
+        for (int idx = 0; idx < 64; ++idx) {
+            fn();
+        }
+        calls += 64;
+        elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::duration<double>(kSecondsPerCase));
+    return static_cast<double>(calls * bytes_per_call) / std::chrono::duration<double>(elapsed).count();
+}
+
+void runCase(const char* scheme, FrameCodec::Framing framing, const Corpus& corpus) {
+    FrameCodec::Parameters params;
+    params.framing = framing;
+    const std::vector<uint8_t>& payload = corpus.payload;
+
+    std::vector<uint8_t> frame(FrameCodec::maxEncodedSize(payload.size(), params));
+    const auto encoded = FrameCodec::encodeInto(payload.data(), payload.size(), frame.data(), frame.size(), params);
+    frame.resize(encoded.bytes_written);
+
+    const double encode_rate = bytesPerSecond(payload.size(), [&]() {
+        FrameCodec::encodeInto(payload.data(), payload.size(), frame.data(), frame.capacity(), params);
+    });
+
+    FrameDecoder::Options options;
+    options.params = params;
+    options.max_frame_bytes = payload.size() + 8;
+    FrameDecoder decoder(options);
+    std::vector<uint8_t> out;
+    out.reserve(options.max_frame_bytes);
+    std::size_t frames = 0;
+    const FrameDecoder::ResultCallback count = [&](const FrameDecoder::Result& result) {
+        frames += result.frame_ready ? 1 : 0;
+    };
+    const double decode_rate = bytesPerSecond(payload.size(), [&]() {
+        decoder.decode(frame.data(), frame.size(), out, count);
+    });
+    if (frames == 0 || out != payload) {
+        std::printf("%-6s %-13s %6zu  decode mismatch\n", scheme, corpus.name, payload.size());
+        return;
+    }
+
+    const double overhead = 100.0 * (static_cast<double>(frame.size()) - static_cast<double>(payload.size())) /
+                            static_cast<double>(payload.size());
+    std::printf("%-6s %-13s %6zu %8zu %8.1f%% %10.1f %10.1f\n", scheme, corpus.name, payload.size(),
+                frame.size(), overhead, encode_rate / 1e6, decode_rate / 1e6);
+}
+
+} // namespace
+
+int main() {
+    std::printf("%-6s %-13s %6s %8s %9s %10s %10s\n", "scheme", "payload", "bytes", "wire", "overhead",
+                "enc MB/s", "dec MB/s");
+    for (std::size_t size : {64u, 256u, 1024u, 4096u}) {
+        for (const Corpus& corpus : corpora(size)) {
+            runCase("slip", FrameCodec::Framing::Slip, corpus);
+            runCase("cobs", FrameCodec::Framing::Cobs, corpus);
+        }
+    }
+    return 0;
+}
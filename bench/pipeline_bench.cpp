@@ -0,0 +1,137 @@
+// End-to-end throughput of encode -> SPI transfer -> decode over a
+// simulated device: a FramedLink streams frames to an echoing peer and
+// times each one until it comes back.
+
+#include "framed_link.h"
+#include "sim_spi.h"
+#include "spi.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+using namespace spi_eak;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double kSecondsPerCase = 0.5;
+constexpr std::size_t kTransferBytes = 512;
+constexpr std::size_t kSeqSlots = 1u << 16;
+
+struct Case {
+    SimulatedSpiDevice::Timing timing;
+    uint32_t speed_hz;
+    std::size_t payload_bytes;
+    double bit_error_rate;
+};
+
+double percentile(std::vector<double>& samples, double fraction) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    const std::size_t rank = std::min(samples.size() - 1, static_cast<std::size_t>(fraction * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + static_cast<std::ptrdiff_t>(rank), samples.end());
+    return samples[rank];
+}
+
+void runCase(const Case& spec) {
+    SimulatedSpiDevice::Options device_options;
+    device_options.timing = spec.timing;
+    std::shared_ptr<SimPeer> peer = std::make_shared<EchoPeer>(std::chrono::microseconds(10));
+    if (spec.bit_error_rate > 0.0) {
+        peer = std::make_shared<BitErrorPeer>(peer, spec.bit_error_rate);
+    }
+    auto device = std::make_shared<SimulatedSpiDevice>(device_options, peer);
+
+    SPI::Config config;
+    config.device = "sim";
+    config.speed_hz = spec.speed_hz;
+    SPI spi(device, config);
+
+    FramedLink::Options options;
+    options.transfer_bytes = kTransferBytes;
+    FramedLink link(spi, options);
+
+    std::vector<uint8_t> payload(spec.payload_bytes);
+    for (std::size_t idx = 0; idx < payload.size(); ++idx) {
+        payload[idx] = static_cast<uint8_t>(idx * 37 + 11);
+    }
+    std::vector<Clock::time_point> sent_at(kSeqSlots);
+    std::vector<double> latencies_us;
+    latencies_us.reserve(1u << 20);
+    uint32_t next_seq = 0;
+    uint64_t received = 0;
+    uint64_t received_bytes = 0;
+    uint64_t dropped = 0;
+
+    const FramedLink::FrameCallback on_frame = [&](const FrameDecoder::Result& result,
+                                                   const std::vector<uint8_t>& frame) {
+        if (!result.frame_ready) {
+            ++dropped;
+            return;
+        }
+        if (frame.size() < 4) {
+            return;
+        }
+        const uint32_t seq = static_cast<uint32_t>(frame[0]) | static_cast<uint32_t>(frame[1]) << 8 |
+                             static_cast<uint32_t>(frame[2]) << 16 | static_cast<uint32_t>(frame[3]) << 24;
+        const auto latency = Clock::now() - sent_at[seq % kSeqSlots];
+        latencies_us.push_back(std::chrono::duration<double, std::micro>(latency).count());
+        ++received;
+        received_bytes += frame.size();
+    };
+
+    const auto start = Clock::now();
+    auto elapsed = Clock::duration::zero();
+    do {
+        while (link.pendingTxBytes() < kTransferBytes) {
+            payload[0] = static_cast<uint8_t>(next_seq);
+            payload[1] = static_cast<uint8_t>(next_seq >> 8);
+            payload[2] = static_cast<uint8_t>(next_seq >> 16);
+            payload[3] = static_cast<uint8_t>(next_seq >> 24);
+            sent_at[next_seq % kSeqSlots] = Clock::now();
+            if (!link.send(payload)) {
+                break;
+            }
+            ++next_seq;
+        }
+        link.exchange(on_frame);
+        elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::duration<double>(kSecondsPerCase));
+
+    const double seconds = std::chrono::duration<double>(elapsed).count();
+    const bool paced = spec.timing == SimulatedSpiDevice::Timing::Paced;
+    std::printf("%-7s %6.1f %7zu %8.0e %10.0f %9.2f %8.1f %8.1f %7llu\n", paced ? "paced" : "virtual",
+                spec.speed_hz / 1e6, spec.payload_bytes, spec.bit_error_rate,
+                static_cast<double>(received) / seconds, static_cast<double>(received_bytes) / seconds / 1e6,
+                percentile(latencies_us, 0.50), percentile(latencies_us, 0.99),
+                static_cast<unsigned long long>(dropped));
+}
+
+} // namespace
+
+int main() {
+    using Timing = SimulatedSpiDevice::Timing;
+    const Case cases[] = {
+        {Timing::Paced, 1'000'000, 64, 0.0},
+        {Timing::Paced, 8'000'000, 64, 0.0},
+        {Timing::Paced, 8'000'000, 256, 0.0},
+        {Timing::Paced, 8'000'000, 256, 1e-5},
+        {Timing::Paced, 32'000'000, 256, 0.0},
+        {Timing::Paced, 32'000'000, 1024, 0.0},
+        // Bus time is not waited out, so these measure the CPU cost of the pipeline.
+        {Timing::Virtual, 32'000'000, 256, 0.0},
+        {Timing::Virtual, 32'000'000, 1024, 0.0},
+    };
+
+    std::printf("%-7s %6s %7s %8s %10s %9s %8s %8s %7s\n", "timing", "MHz", "payload", "BER", "frames/s",
+                "MB/s", "p50 us", "p99 us", "drops");
+    for (const Case& spec : cases) {
+        runCase(spec);
+    }
+    return 0;
+}
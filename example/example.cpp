@@ -35,8 +35,7 @@ int main() {
 
         std::vector<uint8_t> decoded;
         bool frame_complete = false;
-        for (uint8_t byte : rx_frame) {
-            auto result = decoder.push(byte, decoded);
+        const FrameDecoder::ResultCallback on_result = [&](const FrameDecoder::Result& result) {
             if (result.frame_dropped) {
                 std::cout << "Frame dropped due to ";
                 switch (result.drop_reason) {
@@ -56,7 +55,8 @@ int main() {
                 std::cout << std::endl;
             }
             frame_complete = result.frame_ready || frame_complete;
-        }
+        };
+        decoder.decode(rx_frame.data(), rx_frame.size(), decoded, on_result);
 
         std::cout << "Sent frame (" << encode_result.frame.size() << " bytes):";
         for (auto byte : encode_result.frame) {
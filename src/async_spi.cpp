@@ -0,0 +1,239 @@
+#include "async_spi.h"
+#include "sys_util.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace spi_eak {
+
+namespace {
+
+void signalEventFd(int fd) {
+    const uint64_t one = 1;
+    ssize_t written;
+    do {
+        written = ::write(fd, &one, sizeof(one));
+    } while (written < 0 && errno == EINTR);
+}
+
+} // namespace
+
+AsyncSPI::AsyncSPI(SPI& spi, const Options& options)
+    : AsyncSPI(Executor([&spi](uint8_t* rx, const uint8_t* tx, std::size_t length) {
+                   spi.transfer(rx, tx, length);
+               }),
+               options) {}
+
+AsyncSPI::AsyncSPI(SPI& spi)
+    : AsyncSPI(spi, Options{}) {}
+
+AsyncSPI::AsyncSPI(Executor executor, const Options& options)
+    : executor_(std::move(executor))
+    , depth_(options.queue_depth)
+    , submissions_(options.queue_depth)
+    , completions_(options.queue_depth) {
+    if (!executor_) {
+        throw std::invalid_argument("AsyncSPI requires a transfer executor");
+    }
+    if (options.queue_depth == 0) {
+        throw std::invalid_argument("AsyncSPI queue_depth must be non-zero");
+    }
+    start(options.io_thread);
+}
+
+AsyncSPI::~AsyncSPI() {
+    stop();
+    if (wake_fd_ >= 0) {
+        ::close(wake_fd_);
+    }
+    if (completion_fd_ >= 0) {
+        ::close(completion_fd_);
+    }
+}
+
+void AsyncSPI::start(const ThreadPolicy& policy) {
+    wake_fd_ = ::eventfd(0, EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        const int err = errno;
+        throw std::runtime_error("Failed to create AsyncSPI wake eventfd: " + detail::errnoMessage(err));
+    }
+    completion_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (completion_fd_ < 0) {
+        const int err = errno;
+        ::close(wake_fd_);
+        wake_fd_ = -1;
+        throw std::runtime_error("Failed to create AsyncSPI completion eventfd: " + detail::errnoMessage(err));
+    }
+
+    // The thread reports whether its scheduling policy took effect before the
+    // constructor returns, so misconfiguration surfaces as an exception here.
+    std::promise<void> started;
+    std::future<void> started_result = started.get_future();
+    io_thread_ = std::thread([this, policy, &started]() {
+        try {
+            applyThreadPolicy(policy);
+        } catch (...) {
+            started.set_exception(std::current_exception());
+            return;
+        }
+        started.set_value();
+        run();
+    });
+
+    try {
+        started_result.get();
+    } catch (...) {
+        io_thread_.join();
+        ::close(wake_fd_);
+        ::close(completion_fd_);
+        wake_fd_ = -1;
+        completion_fd_ = -1;
+        throw;
+    }
+}
+
+bool AsyncSPI::submit(Request&& request) {
+    if (stopping_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    // Admission control keeps both rings from ever overflowing: every
+    // completion corresponds to one admitted request.
+    if (in_flight_.fetch_add(1, std::memory_order_acq_rel) >= depth_) {
+        in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+        return false;
+    }
+    if (!submissions_.tryPush(std::move(request))) {
+        in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+        return false;
+    }
+    wakeIoThread();
+    return true;
+}
+
+std::future<void> AsyncSPI::submitFuture(const uint8_t* tx, uint8_t* rx, std::size_t length) {
+    auto promise = std::make_shared<std::promise<void>>();
+    std::future<void> future = promise->get_future();
+
+    Request request;
+    request.tx = tx;
+    request.rx = rx;
+    request.length = length;
+    request.on_complete = [promise](const Completion& completion) {
+        if (completion.error) {
+            promise->set_exception(completion.error);
+        } else {
+            promise->set_value();
+        }
+    };
+    if (!submit(std::move(request))) {
+        throw std::runtime_error("AsyncSPI submission queue is full");
+    }
+    return future;
+}
+
+std::size_t AsyncSPI::pollCompletions(const CompletionCallback& handler, std::size_t max_count) {
+    // Clear the eventfd before draining: anything queued afterwards signals
+    // again, so a wakeup is never lost.
+    uint64_t pending;
+    while (::read(completion_fd_, &pending, sizeof(pending)) < 0 && errno == EINTR) {
+    }
+
+    std::size_t handled = 0;
+    Completion completion;
+    while (handled < max_count && completions_.tryPop(completion)) {
+        in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+        ++handled;
+        if (handler) {
+            handler(completion);
+        }
+    }
+    if (handled == max_count && !completions_.empty()) {
+        signalEventFd(completion_fd_);
+    }
+    return handled;
+}
+
+void AsyncSPI::stop() {
+    if (stopping_.exchange(true, std::memory_order_acq_rel)) {
+        if (io_thread_.joinable() && io_thread_.get_id() != std::this_thread::get_id()) {
+            io_thread_.join();
+        }
+        return;
+    }
+    signalEventFd(wake_fd_);
+    if (io_thread_.joinable()) {
+        io_thread_.join();
+    }
+}
+
+void AsyncSPI::wakeIoThread() {
+    // Pairs with the fence in run(): either the I/O thread sees our request on
+    // its re-check, or we see it sleeping and signal the eventfd.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (io_sleeping_.load(std::memory_order_relaxed)) {
+        signalEventFd(wake_fd_);
+    }
+}
+
+void AsyncSPI::run() {
+    Request request;
+    while (true) {
+        if (submissions_.tryPop(request)) {
+            execute(request);
+            continue;
+        }
+        if (stopping_.load(std::memory_order_acquire)) {
+            break;
+        }
+
+        io_sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (submissions_.tryPop(request)) {
+            io_sleeping_.store(false, std::memory_order_relaxed);
+            execute(request);
+            continue;
+        }
+        if (!stopping_.load(std::memory_order_acquire)) {
+            uint64_t count;
+            while (::read(wake_fd_, &count, sizeof(count)) < 0 && errno == EINTR) {
+            }
+        }
+        io_sleeping_.store(false, std::memory_order_relaxed);
+    }
+}
+
+void AsyncSPI::execute(Request& request) {
+    Completion completion;
+    completion.user_data = request.user_data;
+    completion.length = request.length;
+    try {
+        executor_(request.rx, request.tx, request.length);
+    } catch (...) {
+        completion.error = std::current_exception();
+    }
+
+    if (request.on_complete) {
+        CompletionCallback callback = std::move(request.on_complete);
+        request.on_complete = nullptr;
+        // Release the slot first: the callback may wake a submitter (e.g. a
+        // future's waiter) that immediately submits again.
+        in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+        try {
+            callback(completion);
+        } catch (...) {
+            // A throwing callback must not take down the I/O thread.
+        }
+        return;
+    }
+
+    completions_.tryPush(std::move(completion));
+    signalEventFd(completion_fd_);
+}
+
+} // namespace spi_eak
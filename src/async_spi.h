@@ -0,0 +1,132 @@
+#ifndef ASYNC_SPI_H
+#define ASYNC_SPI_H
+
+#include "realtime.h"
+#include "ring_buffer.h"
+#include "spi.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <thread>
+
+namespace spi_eak {
+
+/**
+ * Runs SPI transfers on a dedicated I/O thread so the submitting thread can
+ * prepare the next frame while the current one is on the wire.
+ *
+ * Requests go through a bounded lock-free submission ring (any number of
+ * submitting threads). Each completion is delivered in exactly one way:
+ * - the request's callback, invoked on the I/O thread;
+ * - a future, via submitFuture();
+ * - otherwise the completion queue, signalled through completionFd() (an
+ *   eventfd suitable for epoll) and drained with pollCompletions().
+ *
+ * Buffers referenced by a request must stay valid until it completes.
+ */
+class AsyncSPI {
+public:
+    /**
+     * Performs one full-duplex transfer; throwing reports the error in the
+     * completion. Lets the engine run against a fake device without hardware.
+     */
+    using Executor = std::function<void(uint8_t* rx, const uint8_t* tx, std::size_t length)>;
+
+    struct Options {
+        std::size_t queue_depth = 64; // max requests in flight (rounded to a power of two)
+        ThreadPolicy io_thread;       // CPU pinning / SCHED_FIFO for the I/O thread
+    };
+
+    struct Completion {
+        uint64_t user_data = 0;
+        std::size_t length = 0;
+        std::exception_ptr error; // null on success
+    };
+
+    using CompletionCallback = std::function<void(const Completion&)>;
+
+    struct Request {
+        const uint8_t* tx = nullptr;
+        uint8_t* rx = nullptr;
+        std::size_t length = 0;
+        uint64_t user_data = 0;
+        CompletionCallback on_complete; // empty -> completion queue
+    };
+
+    /**
+     * Drive transfers through `spi`, which must not be used by other threads
+     * while the engine is running.
+     * Throws std::runtime_error if the I/O thread policy cannot be applied.
+     */
+    AsyncSPI(SPI& spi, const Options& options);
+    explicit AsyncSPI(SPI& spi);
+    AsyncSPI(Executor executor, const Options& options);
+
+    /**
+     * Finishes every queued request, then joins the I/O thread.
+     */
+    ~AsyncSPI();
+
+    AsyncSPI(const AsyncSPI&) = delete;
+    AsyncSPI& operator=(const AsyncSPI&) = delete;
+
+    /**
+     * Queue a transfer. Returns false (and leaves `request` untouched) when
+     * queue_depth requests are already in flight.
+     */
+    bool submit(Request&& request);
+
+    /**
+     * Queue a transfer whose completion is reported through a future; the
+     * future rethrows the transfer error, if any.
+     * Throws std::runtime_error when the queue is full.
+     */
+    std::future<void> submitFuture(const uint8_t* tx, uint8_t* rx, std::size_t length);
+
+    /**
+     * eventfd that becomes readable while queued completions are pending.
+     */
+    [[nodiscard]] int completionFd() const noexcept { return completion_fd_; }
+
+    /**
+     * Pop up to max_count queued completions, calling handler for each.
+     * Must be called from a single consumer thread. Returns the number handled.
+     */
+    std::size_t pollCompletions(const CompletionCallback& handler,
+                                std::size_t max_count = static_cast<std::size_t>(-1));
+
+    /**
+     * Finish queued work and stop the I/O thread. Further submissions fail;
+     * call it once submitting threads are done, not concurrently with them.
+     */
+    void stop();
+
+    [[nodiscard]] std::size_t inFlight() const noexcept {
+        return in_flight_.load(std::memory_order_relaxed);
+    }
+
+private:
+    void start(const ThreadPolicy& policy);
+    void run();
+    void execute(Request& request);
+    void wakeIoThread();
+
+    Executor executor_;
+    std::size_t depth_;
+    MpscRing<Request> submissions_;
+    SpscRing<Completion> completions_;
+    std::atomic<std::size_t> in_flight_{0};
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> io_sleeping_{false};
+    int wake_fd_ = -1;
+    int completion_fd_ = -1;
+    std::thread io_thread_;
+};
+
+} // namespace spi_eak
+
+#endif // ASYNC_SPI_H
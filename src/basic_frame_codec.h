@@ -0,0 +1,348 @@
+#ifndef BASIC_FRAME_CODEC_H
+#define BASIC_FRAME_CODEC_H
+
+#include "byte_scan.h"
+#include "crc.h"
+#include "link_layer.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace spi_eak {
+
+/**
+ * Checksum policies for BasicFrameCodec / BasicFrameDecoder.
+ * kBytes is the trailer width; compute() returns the value sent big-endian.
+ */
+struct NoCrc {
+    static constexpr std::size_t kBytes = 0;
+    static constexpr bool kEnabled = false;
+    static constexpr FrameCodec::Checksum kChecksum = FrameCodec::Checksum::Crc16;
+    static uint32_t compute(const uint8_t*, std::size_t) { return 0; }
+};
+
+struct Crc16Policy {
+    static constexpr std::size_t kBytes = 2;
+    static constexpr bool kEnabled = true;
+    static constexpr FrameCodec::Checksum kChecksum = FrameCodec::Checksum::Crc16;
+    static uint32_t compute(const uint8_t* data, std::size_t length) {
+        return crc::crc16_ccitt(data, length);
+    }
+};
+
+struct Crc32CPolicy {
+    static constexpr std::size_t kBytes = 4;
+    static constexpr bool kEnabled = true;
+    static constexpr FrameCodec::Checksum kChecksum = FrameCodec::Checksum::Crc32C;
+    static uint32_t compute(const uint8_t* data, std::size_t length) {
+        return crc::crc32c(data, length);
+    }
+};
+
+namespace detail {
+
+enum ByteClass : uint8_t {
+    kPlainByte = 0,
+    kStartByte,
+    kStopByte,
+    kEscapeByte
+};
+
+template <uint8_t Start, uint8_t Stop, uint8_t Escape>
+struct ByteClassTable {
+    static constexpr std::array<uint8_t, 256> make() {
+        std::array<uint8_t, 256> table{};
+        table[Start] = kStartByte;
+        table[Stop] = kStopByte;
+        table[Escape] = kEscapeByte;
+        return table;
+    }
+
+    static constexpr std::array<uint8_t, 256> kTable = make();
+};
+
+} // namespace detail
+
+/**
+ * Frame encoder with the sentinels and checksum fixed at compile time.
+ * Produces byte-for-byte the same frames as FrameCodec with parameters().
+ * Invalid sentinel combinations fail to compile instead of at runtime.
+ */
+template <uint8_t Start, uint8_t Stop, uint8_t Escape, typename CrcPolicy = Crc16Policy>
+class BasicFrameCodec {
+    static_assert(Start != Stop, "start and stop bytes must differ");
+    static_assert(Escape != Start && Escape != Stop, "escape byte must differ from start and stop bytes");
+    static_assert((Start ^ 0x20) != Stop && (Start ^ 0x20) != Escape &&
+                      (Stop ^ 0x20) != Start && (Stop ^ 0x20) != Escape &&
+                      (Escape ^ 0x20) != Start && (Escape ^ 0x20) != Stop,
+                  "escaped sentinel values must not themselves be sentinels");
+
+public:
+    static constexpr uint8_t kStart = Start;
+    static constexpr uint8_t kStop = Stop;
+    static constexpr uint8_t kEscape = Escape;
+    using Crc = CrcPolicy;
+
+    /**
+     * Equivalent runtime parameters, for interop with FrameCodec/FrameDecoder.
+     */
+    static constexpr FrameCodec::Parameters parameters() {
+        FrameCodec::Parameters params;
+        params.start_byte = Start;
+        params.stop_byte = Stop;
+        params.escape_byte = Escape;
+        params.enable_crc16 = CrcPolicy::kEnabled;
+        params.checksum = CrcPolicy::kChecksum;
+        return params;
+    }
+
+    static constexpr std::size_t maxEncodedSize(std::size_t payload_length) {
+        return 2 + 2 * (payload_length + CrcPolicy::kBytes);
+    }
+
+    static constexpr bool needsEscape(uint8_t value) {
+        return detail::ByteClassTable<Start, Stop, Escape>::kTable[value] != detail::kPlainByte;
+    }
+
+    static std::size_t encodedSize(const uint8_t* payload, std::size_t length) {
+        return frameSize(payload, length, CrcPolicy::compute(payload, length));
+    }
+
+    /**
+     * Same contract as FrameCodec::encodeInto.
+     */
+    static FrameCodec::EncodeIntoResult encodeInto(const uint8_t* payload,
+                                                   std::size_t length,
+                                                   uint8_t* out,
+                                                   std::size_t capacity) {
+        FrameCodec::EncodeIntoResult result;
+        if (!out || (!payload && length > 0)) {
+            result.ok = false;
+            result.error = FrameCodec::EncodeError::BufferTooSmall;
+            return result;
+        }
+        const uint32_t crc = CrcPolicy::compute(payload, length);
+        if (capacity < maxEncodedSize(length) && capacity < frameSize(payload, length, crc)) {
+            result.ok = false;
+            result.error = FrameCodec::EncodeError::BufferTooSmall;
+            return result;
+        }
+        result.bytes_written = writeFrame(out, payload, length, crc);
+        return result;
+    }
+
+    static FrameCodec::Result encode(const std::vector<uint8_t>& payload) {
+        FrameCodec::Result result;
+        const uint32_t crc = CrcPolicy::compute(payload.data(), payload.size());
+        result.frame.resize(frameSize(payload.data(), payload.size(), crc));
+        writeFrame(result.frame.data(), payload.data(), payload.size(), crc);
+        return result;
+    }
+
+private:
+    static std::size_t frameSize(const uint8_t* payload, std::size_t length, uint32_t crc) {
+        std::size_t size = 2 + length + detail::countAnyOf3(payload, length, Start, Stop, Escape);
+        for (std::size_t idx = CrcPolicy::kBytes; idx > 0; --idx) {
+            size += needsEscape(static_cast<uint8_t>(crc >> (8 * (idx - 1)))) ? 2 : 1;
+        }
+        return size;
+    }
+
+    // Caller guarantees `out` holds at least frameSize() bytes.
+    static std::size_t writeFrame(uint8_t* out, const uint8_t* payload, std::size_t length, uint32_t crc) {
+        uint8_t* cursor = out;
+        *cursor++ = Start;
+        std::size_t idx = 0;
+        while (idx < length) {
+            // The class table settles a sentinel without starting a scan
+            // that would stop at offset 0.
+            if (needsEscape(payload[idx])) {
+                *cursor++ = Escape;
+                *cursor++ = static_cast<uint8_t>(payload[idx] ^ 0x20);
+                ++idx;
+                continue;
+            }
+            const std::size_t run = detail::findAnyOf3(payload + idx, length - idx, Start, Stop, Escape);
+            std::memcpy(cursor, payload + idx, run);
+            cursor += run;
+            idx += run;
+        }
+
+        for (std::size_t shift = CrcPolicy::kBytes; shift > 0; --shift) {
+            const uint8_t value = static_cast<uint8_t>(crc >> (8 * (shift - 1)));
+            if (needsEscape(value)) {
+                *cursor++ = Escape;
+                *cursor++ = static_cast<uint8_t>(value ^ 0x20);
+            } else {
+                *cursor++ = value;
+            }
+        }
+        *cursor++ = Stop;
+        return static_cast<std::size_t>(cursor - out);
+    }
+};
+
+/**
+ * Frame decoder with compile-time sentinels and checksum. Bytes are
+ * classified through a constexpr 256-entry table so the per-byte dispatch
+ * folds into a single indexed load; behaviour matches FrameDecoder exactly.
+ */
+template <uint8_t Start, uint8_t Stop, uint8_t Escape, typename CrcPolicy = Crc16Policy>
+class BasicFrameDecoder {
+public:
+    using Codec = BasicFrameCodec<Start, Stop, Escape, CrcPolicy>;
+    using Result = FrameDecoder::Result;
+    using DecodeSummary = FrameDecoder::DecodeSummary;
+    using ResultCallback = FrameDecoder::ResultCallback;
+
+    explicit BasicFrameDecoder(std::size_t max_frame_bytes = 2048)
+        : max_frame_bytes_(max_frame_bytes) {
+        if (max_frame_bytes_ == 0) {
+            throw std::invalid_argument("BasicFrameDecoder max_frame_bytes must be non-zero");
+        }
+        buffer_.reserve(max_frame_bytes_);
+    }
+
+    Result push(uint8_t byte, std::vector<uint8_t>& out_frame) {
+        switch (kClass[byte]) {
+            case detail::kStartByte:
+                buffer_.clear();
+                in_frame_ = true;
+                escape_next_ = false;
+                return Result{};
+            case detail::kStopByte:
+                return in_frame_ ? finish(out_frame) : Result{};
+            case detail::kEscapeByte:
+                if (in_frame_ && !escape_next_) {
+                    escape_next_ = true;
+                    return Result{};
+                }
+                break;
+            default:
+                break;
+        }
+
+        if (!in_frame_) {
+            return Result{};
+        }
+        if (buffer_.size() >= max_frame_bytes_) {
+            return drop(Result::DropReason::FrameTooLarge);
+        }
+        buffer_.push_back(escape_next_ ? static_cast<uint8_t>(byte ^ 0x20) : byte);
+        escape_next_ = false;
+        return Result{};
+    }
+
+    DecodeSummary decode(const uint8_t* data,
+                         std::size_t length,
+                         std::vector<uint8_t>& out_frame,
+                         const ResultCallback& on_result) {
+        DecodeSummary summary;
+        if (!data) {
+            return summary;
+        }
+
+        auto report = [&](const Result& result) {
+            summary.frames_ready += result.frame_ready ? 1 : 0;
+            summary.frames_dropped += result.frame_dropped ? 1 : 0;
+            if ((result.frame_ready || result.frame_dropped) && on_result) {
+                on_result(result);
+            }
+        };
+
+        std::size_t idx = 0;
+        while (idx < length) {
+            if (!in_frame_) {
+                const void* hit = std::memchr(data + idx, Start, length - idx);
+                if (!hit) {
+                    break;
+                }
+                idx = static_cast<std::size_t>(static_cast<const uint8_t*>(hit) - data);
+            } else if (!escape_next_) {
+                // The class table settles sentinels without a scan that
+                // would stop at offset 0, as in Codec::writeFrame.
+                const uint8_t byte_class = kClass[data[idx]];
+                if (byte_class == detail::kEscapeByte) {
+                    // Unescape a complete pair in place; a pair split across
+                    // calls, or one that ends the frame early, takes push().
+                    if (idx + 1 < length && kClass[data[idx + 1]] != detail::kStartByte &&
+                        kClass[data[idx + 1]] != detail::kStopByte && buffer_.size() < max_frame_bytes_) {
+                        buffer_.push_back(static_cast<uint8_t>(data[idx + 1] ^ 0x20));
+                        idx += 2;
+                        continue;
+                    }
+                } else if (byte_class == detail::kPlainByte) {
+                    const std::size_t run = detail::findAnyOf3(data + idx, length - idx, Start, Stop, Escape);
+                    const std::size_t room = max_frame_bytes_ - buffer_.size();
+                    if (run > room) {
+                        report(drop(Result::DropReason::FrameTooLarge));
+                        idx += room + 1;
+                        continue;
+                    }
+                    buffer_.insert(buffer_.end(), data + idx, data + idx + run);
+                    idx += run;
+                    continue;
+                }
+            }
+            report(push(data[idx], out_frame));
+            ++idx;
+        }
+        return summary;
+    }
+
+    void reset() {
+        in_frame_ = false;
+        escape_next_ = false;
+        buffer_.clear();
+    }
+
+private:
+    Result finish(std::vector<uint8_t>& out_frame) {
+        if (CrcPolicy::kBytes > 0) {
+            if (buffer_.size() < CrcPolicy::kBytes) {
+                return drop(Result::DropReason::TooShortForCrc);
+            }
+            const std::size_t payload_size = buffer_.size() - CrcPolicy::kBytes;
+            uint32_t received = 0;
+            for (std::size_t idx = 0; idx < CrcPolicy::kBytes; ++idx) {
+                received = (received << 8) | buffer_[payload_size + idx];
+            }
+            if (CrcPolicy::compute(buffer_.data(), payload_size) != received) {
+                return drop(Result::DropReason::CrcMismatch);
+            }
+            buffer_.resize(payload_size);
+        }
+        out_frame.swap(buffer_);
+        reset();
+        buffer_.reserve(max_frame_bytes_);
+        Result result;
+        result.frame_ready = true;
+        return result;
+    }
+
+    Result drop(Result::DropReason reason) {
+        reset();
+        Result result;
+        result.frame_dropped = true;
+        result.drop_reason = reason;
+        return result;
+    }
+
+    static constexpr const std::array<uint8_t, 256>& kClass = detail::ByteClassTable<Start, Stop, Escape>::kTable;
+
+    std::size_t max_frame_bytes_;
+    bool in_frame_ = false;
+    bool escape_next_ = false;
+    std::vector<uint8_t> buffer_;
+};
+
+using DefaultFrameCodec = BasicFrameCodec<0x7E, 0x7F, 0x7D, Crc16Policy>;
+using DefaultFrameDecoder = BasicFrameDecoder<0x7E, 0x7F, 0x7D, Crc16Policy>;
+
+} // namespace spi_eak
+
+#endif // BASIC_FRAME_CODEC_H
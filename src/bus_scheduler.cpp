@@ -0,0 +1,238 @@
+#include "bus_scheduler.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace spi_eak {
+
+bool BusScheduler::EntryOrder::operator()(const std::unique_ptr<Entry>& lhs,
+                                          const std::unique_ptr<Entry>& rhs) const {
+    const Transaction& a = lhs->transaction;
+    const Transaction& b = rhs->transaction;
+    if (policy == Policy::EarliestDeadline) {
+        if (a.deadline != b.deadline) {
+            return a.deadline < b.deadline;
+        }
+        if (a.priority != b.priority) {
+            return a.priority > b.priority;
+        }
+    } else {
+        if (a.priority != b.priority) {
+            return a.priority > b.priority;
+        }
+        if (a.deadline != b.deadline) {
+            return a.deadline < b.deadline;
+        }
+    }
+    return lhs->sequence < rhs->sequence;
+}
+
+BusScheduler::BusScheduler()
+    : BusScheduler(Options{}) {}
+
+BusScheduler::BusScheduler(const Options& options)
+    : options_(options)
+    , queue_(EntryOrder{options.policy}) {
+    if (options_.max_batch == 0) {
+        throw std::invalid_argument("BusScheduler max_batch must be non-zero");
+    }
+    if (options_.max_slice_bytes == 0) {
+        throw std::invalid_argument("BusScheduler max_slice_bytes must be non-zero");
+    }
+    batch_.reserve(options_.max_batch);
+    segments_.reserve(options_.max_batch);
+}
+
+BusScheduler::~BusScheduler() {
+    stop();
+}
+
+BusScheduler::DeviceId BusScheduler::addDevice(SPI&& spi) {
+    if (!spi.isOpen()) {
+        throw std::invalid_argument("BusScheduler requires an open SPI handle");
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    devices_.push_back(std::make_unique<SPI>(std::move(spi)));
+    return devices_.size() - 1;
+}
+
+SPI& BusScheduler::device(DeviceId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id >= devices_.size()) {
+        throw std::out_of_range("Unknown BusScheduler device id");
+    }
+    return *devices_[id];
+}
+
+void BusScheduler::submit(Transaction transaction) {
+    if (transaction.length == 0) {
+        throw std::invalid_argument("BusScheduler transaction length must be non-zero");
+    }
+    if (!transaction.tx && !transaction.rx) {
+        throw std::invalid_argument("BusScheduler transaction needs a TX or RX buffer");
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->transaction = std::move(transaction);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (entry->transaction.device >= devices_.size()) {
+            throw std::invalid_argument("Unknown BusScheduler device id");
+        }
+        if (!entry->transaction.preemptible &&
+            entry->transaction.length > devices_[entry->transaction.device]->messageLimit()) {
+            throw std::invalid_argument(
+                "BusScheduler transaction exceeds the device message limit; mark it preemptible to slice it");
+        }
+        entry->sequence = next_sequence_++;
+        queue_.insert(std::move(entry));
+    }
+    work_ready_.notify_one();
+}
+
+std::size_t BusScheduler::dispatchPending() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (dispatcher_.joinable()) {
+        throw std::logic_error("BusScheduler is already dispatching on its own thread");
+    }
+    std::size_t ioctls = 0;
+    while (dispatchOne(lock)) {
+        ++ioctls;
+    }
+    return ioctls;
+}
+
+void BusScheduler::start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dispatcher_.joinable()) {
+        return;
+    }
+    stopping_ = false;
+    dispatcher_ = std::thread([this]() { run(); });
+}
+
+void BusScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!dispatcher_.joinable()) {
+            return;
+        }
+        stopping_ = true;
+    }
+    work_ready_.notify_all();
+    dispatcher_.join();
+}
+
+std::size_t BusScheduler::pending() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void BusScheduler::run() {
+    try {
+        applyThreadPolicy(options_.dispatch_thread);
+    } catch (...) {
+        // Keep dispatching with default scheduling rather than stalling the bus.
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        work_ready_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            break; // stopping and drained
+        }
+        dispatchOne(lock);
+    }
+}
+
+// Called with `lock` held; returns with it held. Issues one ioctl.
+bool BusScheduler::dispatchOne(std::unique_lock<std::mutex>& lock) {
+    if (queue_.empty()) {
+        return false;
+    }
+
+    // Head of the queue plus whatever directly follows it for the same
+    // device, as long as the message stays within the driver's limit.
+    batch_.clear();
+    segments_.clear();
+    const DeviceId device_id = (*queue_.begin())->transaction.device;
+    SPI* spi = devices_[device_id].get();
+    const std::size_t limit = spi->messageLimit();
+    const std::size_t slice = std::min(options_.max_slice_bytes, limit);
+    std::size_t tx_bytes = 0;
+    std::size_t rx_bytes = 0;
+    while (!queue_.empty() && batch_.size() < options_.max_batch) {
+        auto first = queue_.begin();
+        const Entry& next = **first;
+        const Transaction& txn = next.transaction;
+        if (txn.device != device_id) {
+            break;
+        }
+        std::size_t length = txn.length - next.offset;
+        const bool sliced = txn.preemptible && length > slice;
+        if (sliced) {
+            length = slice;
+        }
+        if (!batch_.empty() && ((txn.tx && tx_bytes + length > limit) || (txn.rx && rx_bytes + length > limit))) {
+            break;
+        }
+        tx_bytes += txn.tx ? length : 0;
+        rx_bytes += txn.rx ? length : 0;
+
+        SPI::Segment segment;
+        segment.tx_buffer = txn.tx ? txn.tx + next.offset : nullptr;
+        segment.rx_buffer = txn.rx ? txn.rx + next.offset : nullptr;
+        segment.length = length;
+        segment.speed_override_hz = txn.speed_override_hz;
+        segment.cs_change = true; // each transaction gets its own CS assertion
+        segments_.push_back(segment);
+        batch_.push_back(std::move(queue_.extract(first).value()));
+        if (sliced) {
+            break; // a slice ends the batch so urgent work can run next
+        }
+    }
+    lock.unlock();
+
+    segments_.back().cs_change = false;
+
+    std::exception_ptr error;
+    try {
+        spi->transfer(segments_);
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    const Clock::time_point now = Clock::now();
+    for (std::size_t idx = 0; idx < batch_.size(); ++idx) {
+        Entry& entry = *batch_[idx];
+        entry.offset += segments_[idx].length;
+        if (!error && entry.offset < entry.transaction.length) {
+            continue; // remaining slices are requeued below
+        }
+        if (entry.transaction.on_complete) {
+            Completion completion;
+            completion.device = device_id;
+            completion.user_data = entry.transaction.user_data;
+            completion.deadline_missed = now > entry.transaction.deadline;
+            completion.error = error;
+            try {
+                entry.transaction.on_complete(completion);
+            } catch (...) {
+                // A throwing callback must not stall the bus.
+            }
+        }
+        batch_[idx].reset();
+    }
+
+    lock.lock();
+    for (auto& entry : batch_) {
+        if (entry) {
+            queue_.insert(std::move(entry));
+        }
+    }
+    batch_.clear();
+    return true;
+}
+
+} // namespace spi_eak
@@ -0,0 +1,146 @@
+#ifndef BUS_SCHEDULER_H
+#define BUS_SCHEDULER_H
+
+#include "realtime.h"
+#include "spi.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace spi_eak {
+
+/**
+ * Serialises transactions for several chip selects on one SPI controller.
+ *
+ * The scheduler owns one SPI handle per chip select and dispatches queued
+ * transactions in earliest-deadline-first or priority order. Consecutive
+ * transactions for the same device are batched into a single
+ * SPI_IOC_MESSAGE (CS toggles between them) while it fits the device's
+ * messageLimit(). Switching devices never issues
+ * configuration ioctls: each handle keeps its own spidev state, and
+ * per-transaction speed overrides travel in the transfer descriptor.
+ *
+ * Preemptible transactions longer than max_slice_bytes are sent in slices so
+ * urgent work for other devices can run between them.
+ */
+class BusScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+    using DeviceId = std::size_t;
+
+    enum class Policy {
+        EarliestDeadline, // deadline, then priority, then submission order
+        Priority          // priority, then deadline, then submission order
+    };
+
+    struct Options {
+        Policy policy = Policy::EarliestDeadline;
+        std::size_t max_batch = 16;          // transactions per ioctl
+        std::size_t max_slice_bytes = 4096;  // slice size for preemptible transactions; capped at messageLimit()
+        ThreadPolicy dispatch_thread;        // used by start()
+    };
+
+    struct Completion {
+        DeviceId device = 0;
+        uint64_t user_data = 0;
+        bool deadline_missed = false;
+        std::exception_ptr error; // null on success
+    };
+
+    using CompletionCallback = std::function<void(const Completion&)>;
+
+    struct Transaction {
+        DeviceId device = 0;
+        int priority = 0; // larger runs first
+        Clock::time_point deadline = Clock::time_point::max();
+        const uint8_t* tx = nullptr;
+        uint8_t* rx = nullptr;
+        std::size_t length = 0;
+        uint32_t speed_override_hz = 0; // 0 -> device config
+        bool preemptible = false;       // allow slicing (CS toggles between slices)
+        uint64_t user_data = 0;
+        CompletionCallback on_complete; // runs on the dispatching thread
+    };
+
+    BusScheduler();
+    explicit BusScheduler(const Options& options);
+    ~BusScheduler();
+
+    BusScheduler(const BusScheduler&) = delete;
+    BusScheduler& operator=(const BusScheduler&) = delete;
+
+    /**
+     * Take ownership of an SPI handle on this bus. Returns its device id.
+     */
+    DeviceId addDevice(SPI&& spi);
+
+    /**
+     * Access a device's handle, e.g. to change its config. Do not transfer
+     * through it directly while the scheduler is running.
+     */
+    SPI& device(DeviceId id);
+
+    /**
+     * Queue a transaction (thread-safe).
+     * Throws std::invalid_argument for unknown devices, empty buffers, or a
+     * non-preemptible transaction larger than the device's messageLimit().
+     */
+    void submit(Transaction transaction);
+
+    /**
+     * Dispatch queued work on the calling thread until the queue is empty.
+     * Returns the number of ioctls issued. Use either this or start().
+     */
+    std::size_t dispatchPending();
+
+    /**
+     * Run a background dispatch thread; stop() drains the queue and joins it.
+     */
+    void start();
+    void stop();
+
+    [[nodiscard]] std::size_t pending() const;
+
+private:
+    struct Entry {
+        Transaction transaction;
+        uint64_t sequence = 0;
+        std::size_t offset = 0; // bytes already sent (sliced transactions)
+    };
+
+    struct EntryOrder {
+        Policy policy;
+        bool operator()(const std::unique_ptr<Entry>& lhs, const std::unique_ptr<Entry>& rhs) const;
+    };
+
+    using Queue = std::multiset<std::unique_ptr<Entry>, EntryOrder>;
+
+    bool dispatchOne(std::unique_lock<std::mutex>& lock);
+    void run();
+
+    Options options_;
+    mutable std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::vector<std::unique_ptr<SPI>> devices_;
+    Queue queue_;
+    uint64_t next_sequence_ = 0;
+    bool stopping_ = false;
+    std::thread dispatcher_;
+
+    // Dispatcher-only scratch, reused so steady-state dispatch does not allocate.
+    std::vector<std::unique_ptr<Entry>> batch_;
+    std::vector<SPI::Segment> segments_;
+};
+
+} // namespace spi_eak
+
+#endif // BUS_SCHEDULER_H
@@ -0,0 +1,122 @@
+#ifndef BYTE_SCAN_H
+#define BYTE_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace spi_eak {
+namespace detail {
+
+/**
+ * Return the offset of the first byte in [data, data + length) that equals
+ * a, b or c, or length when no such byte exists.
+ * Uses 16-byte SSE2/NEON compares when available with a scalar tail.
+ */
+inline std::size_t findAnyOf3(const uint8_t* data,
+                              std::size_t length,
+                              uint8_t a,
+                              uint8_t b,
+                              uint8_t c) noexcept {
+    std::size_t idx = 0;
+#if defined(__SSE2__)
+    const __m128i va = _mm_set1_epi8(static_cast<char>(a));
+    const __m128i vb = _mm_set1_epi8(static_cast<char>(b));
+    const __m128i vc = _mm_set1_epi8(static_cast<char>(c));
+    for (; idx + 16 <= length; idx += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + idx));
+        const __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, va),
+                                                      _mm_cmpeq_epi8(chunk, vb)),
+                                         _mm_cmpeq_epi8(chunk, vc));
+        const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+        if (mask) {
+            return idx + static_cast<std::size_t>(__builtin_ctz(mask));
+        }
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t va = vdupq_n_u8(a);
+    const uint8x16_t vb = vdupq_n_u8(b);
+    const uint8x16_t vc = vdupq_n_u8(c);
+    for (; idx + 16 <= length; idx += 16) {
+        const uint8x16_t chunk = vld1q_u8(data + idx);
+        const uint8x16_t hit = vorrq_u8(vorrq_u8(vceqq_u8(chunk, va), vceqq_u8(chunk, vb)),
+                                        vceqq_u8(chunk, vc));
+        // Narrow each 0x00/0xFF lane to a nibble so the mask fits in 64 bits.
+        const uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(hit), 4);
+        const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(nibbles), 0);
+        if (mask) {
+            return idx + static_cast<std::size_t>(__builtin_ctzll(mask) >> 2);
+        }
+    }
+#endif
+    for (; idx < length; ++idx) {
+        const uint8_t value = data[idx];
+        if (value == a || value == b || value == c) {
+            return idx;
+        }
+    }
+    return length;
+}
+
+/**
+ * Count the bytes in [data, data + length) that equal a, b or c.
+ * Vector lanes accumulate per-byte counters that are folded into the total
+ * before they can overflow.
+ */
+inline std::size_t countAnyOf3(const uint8_t* data,
+                               std::size_t length,
+                               uint8_t a,
+                               uint8_t b,
+                               uint8_t c) noexcept {
+    std::size_t idx = 0;
+    std::size_t total = 0;
+#if defined(__SSE2__)
+    const __m128i va = _mm_set1_epi8(static_cast<char>(a));
+    const __m128i vb = _mm_set1_epi8(static_cast<char>(b));
+    const __m128i vc = _mm_set1_epi8(static_cast<char>(c));
+    const __m128i zero = _mm_setzero_si128();
+    while (idx + 16 <= length) {
+        __m128i acc = _mm_setzero_si128();
+        for (int block = 0; block < 255 && idx + 16 <= length; ++block, idx += 16) {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + idx));
+            const __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, va),
+                                                          _mm_cmpeq_epi8(chunk, vb)),
+                                             _mm_cmpeq_epi8(chunk, vc));
+            acc = _mm_sub_epi8(acc, hit); // matching lanes are 0xFF == -1
+        }
+        const __m128i sums = _mm_sad_epu8(acc, zero);
+        total += static_cast<std::size_t>(_mm_cvtsi128_si32(sums));
+        total += static_cast<std::size_t>(_mm_cvtsi128_si32(_mm_unpackhi_epi64(sums, sums)));
+    }
+#elif defined(__ARM_NEON)
+    const uint8x16_t va = vdupq_n_u8(a);
+    const uint8x16_t vb = vdupq_n_u8(b);
+    const uint8x16_t vc = vdupq_n_u8(c);
+    while (idx + 16 <= length) {
+        uint8x16_t acc = vdupq_n_u8(0);
+        for (int block = 0; block < 255 && idx + 16 <= length; ++block, idx += 16) {
+            const uint8x16_t chunk = vld1q_u8(data + idx);
+            const uint8x16_t hit = vorrq_u8(vorrq_u8(vceqq_u8(chunk, va), vceqq_u8(chunk, vb)),
+                                            vceqq_u8(chunk, vc));
+            acc = vsubq_u8(acc, hit);
+        }
+        const uint64x2_t sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(acc)));
+        total += static_cast<std::size_t>(vgetq_lane_u64(sums, 0) + vgetq_lane_u64(sums, 1));
+    }
+#endif
+    for (; idx < length; ++idx) {
+        const uint8_t value = data[idx];
+        total += (value == a || value == b || value == c) ? 1 : 0;
+    }
+    return total;
+}
+
+} // namespace detail
+} // namespace spi_eak
+
+#endif // BYTE_SCAN_H
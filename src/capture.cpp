@@ -0,0 +1,270 @@
+#include "capture.h"
+#include "sys_util.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <ctime>
+#include <limits>
+#include <stdexcept>
+
+namespace spi_eak {
+
+namespace {
+
+using capture::FileHeader;
+using capture::RecordHeader;
+
+uint64_t clockNs(clockid_t clock) {
+    timespec ts{};
+    clock_gettime(clock, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000u + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+std::size_t recordBytes(std::size_t length, uint8_t flags) {
+    const std::size_t directions = ((flags & capture::kRecordHasTx) ? 1 : 0) +
+                                   ((flags & capture::kRecordHasRx) ? 1 : 0);
+    const std::size_t bytes = sizeof(RecordHeader) + length * directions;
+    return (bytes + 7) & ~std::size_t{7};
+}
+
+} // namespace
+
+CaptureWriter::CaptureWriter(const std::string& path)
+    : CaptureWriter(path, Options{}) {}
+
+CaptureWriter::CaptureWriter(const std::string& path, const Options& options)
+    : capacity_((options.capacity_bytes + 7) & ~std::size_t{7}) {
+    if (capacity_ < 4 * sizeof(RecordHeader)) {
+        throw std::invalid_argument("CaptureWriter capacity_bytes is too small");
+    }
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0) {
+        const int err = errno;
+        throw std::runtime_error("Failed to create capture file '" + path + "': " + detail::errnoMessage(err));
+    }
+
+    map_bytes_ = sizeof(FileHeader) + capacity_;
+    if (::ftruncate(fd_, static_cast<off_t>(map_bytes_)) < 0) {
+        const int err = errno;
+        ::close(fd_);
+        throw std::runtime_error("Failed to size capture file '" + path + "': " + detail::errnoMessage(err));
+    }
+    void* map = ::mmap(nullptr, map_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        const int err = errno;
+        ::close(fd_);
+        throw std::runtime_error("Failed to map capture file '" + path + "': " + detail::errnoMessage(err));
+    }
+
+    map_ = static_cast<uint8_t*>(map);
+    header_ = reinterpret_cast<FileHeader*>(map_);
+    data_ = map_ + sizeof(FileHeader);
+
+    std::memset(header_, 0, sizeof(FileHeader));
+    std::memcpy(header_->magic, capture::kMagic, sizeof(header_->magic));
+    header_->version = capture::kVersion;
+    header_->flags = options.ring ? capture::kFileRing : 0;
+    header_->capacity = capacity_;
+    header_->start_monotonic_ns = clockNs(CLOCK_MONOTONIC);
+    header_->start_realtime_ns = clockNs(CLOCK_REALTIME);
+}
+
+CaptureWriter::~CaptureWriter() {
+    const bool ring = (header_->flags & capture::kFileRing) != 0;
+    const std::size_t used = sizeof(FileHeader) + header_->tail;
+    ::msync(map_, map_bytes_, MS_ASYNC);
+    ::munmap(map_, map_bytes_);
+    if (!ring) {
+        // An append-only capture never needs the unused tail of the region.
+        (void)::ftruncate(fd_, static_cast<off_t>(used));
+    }
+    ::close(fd_);
+}
+
+bool CaptureWriter::record(const uint8_t* tx, const uint8_t* rx, std::size_t length, uint16_t channel) {
+    const uint64_t now = clockNs(CLOCK_MONOTONIC);
+    const uint8_t flags = static_cast<uint8_t>((tx ? capture::kRecordHasTx : 0) |
+                                               (rx ? capture::kRecordHasRx : 0));
+    const std::size_t bytes = recordBytes(length, flags);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint8_t* out = length <= std::numeric_limits<uint32_t>::max() ? reserve(bytes) : nullptr;
+    if (!out) {
+        ++header_->records_dropped;
+        return false;
+    }
+
+    RecordHeader record{};
+    record.timestamp_ns = now;
+    record.length = static_cast<uint32_t>(length);
+    record.channel = channel;
+    record.flags = flags;
+    std::memcpy(out, &record, sizeof(record));
+    uint8_t* cursor = out + sizeof(record);
+    if (tx) {
+        std::memcpy(cursor, tx, length);
+        cursor += length;
+    }
+    if (rx) {
+        std::memcpy(cursor, rx, length);
+    }
+
+    // Publish after the payload so a crash mid-copy never exposes a torn record.
+    header_->tail += bytes;
+    ++header_->records;
+    return true;
+}
+
+// Make room for `bytes` at the tail; returns where to write or null to drop.
+uint8_t* CaptureWriter::reserve(std::size_t bytes) noexcept {
+    FileHeader& header = *header_;
+    if (bytes > capacity_) {
+        return nullptr;
+    }
+
+    if (header.tail + bytes > capacity_) {
+        if (!(header.flags & capture::kFileRing)) {
+            return nullptr;
+        }
+        // Retire everything between the tail and the end, then restart at 0.
+        while (header.records > 0 && header.head >= header.tail) {
+            evictOldest();
+        }
+        if (capacity_ - header.tail >= sizeof(RecordHeader)) {
+            RecordHeader marker{};
+            marker.flags = capture::kRecordWrap;
+            std::memcpy(data_ + header.tail, &marker, sizeof(marker));
+        }
+        header.tail = 0;
+    }
+
+    while (header.records > 0 && header.head >= header.tail && header.head < header.tail + bytes) {
+        evictOldest();
+    }
+    if (header.records == 0) {
+        header.head = header.tail;
+    }
+    return data_ + header.tail;
+}
+
+void CaptureWriter::evictOldest() noexcept {
+    FileHeader& header = *header_;
+    if (capacity_ - header.head < sizeof(RecordHeader)) {
+        header.head = 0;
+        return;
+    }
+    RecordHeader record;
+    std::memcpy(&record, data_ + header.head, sizeof(record));
+    if (record.flags & capture::kRecordWrap) {
+        header.head = 0;
+        return;
+    }
+    header.head += recordBytes(record.length, record.flags);
+    --header.records;
+    ++header.records_overwritten;
+}
+
+void CaptureWriter::flush() {
+    if (::msync(map_, map_bytes_, MS_ASYNC) < 0) {
+        const int err = errno;
+        throw std::runtime_error("Failed to flush capture file: " + detail::errnoMessage(err));
+    }
+}
+
+uint64_t CaptureWriter::records() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return header_->records;
+}
+
+uint64_t CaptureWriter::recordsDropped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return header_->records_dropped;
+}
+
+CaptureReader::CaptureReader(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        const int err = errno;
+        throw std::runtime_error("Failed to open capture file '" + path + "': " + detail::errnoMessage(err));
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) < 0 || static_cast<std::size_t>(st.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Capture file '" + path + "' is truncated");
+    }
+
+    map_bytes_ = static_cast<std::size_t>(st.st_size);
+    void* map = ::mmap(nullptr, map_bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+    const int err = errno;
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        throw std::runtime_error("Failed to map capture file '" + path + "': " + detail::errnoMessage(err));
+    }
+
+    map_ = static_cast<uint8_t*>(map);
+    header_ = reinterpret_cast<const FileHeader*>(map_);
+    data_ = map_ + sizeof(FileHeader);
+    data_bytes_ = map_bytes_ - sizeof(FileHeader);
+
+    const bool valid = std::memcmp(header_->magic, capture::kMagic, sizeof(header_->magic)) == 0 &&
+                       header_->version == capture::kVersion &&
+                       header_->head <= data_bytes_ && header_->tail <= data_bytes_ &&
+                       data_bytes_ <= header_->capacity;
+    if (!valid) {
+        ::munmap(map_, map_bytes_);
+        throw std::runtime_error("'" + path + "' is not a valid capture file");
+    }
+    rewind();
+}
+
+CaptureReader::~CaptureReader() {
+    ::munmap(map_, map_bytes_);
+}
+
+void CaptureReader::rewind() noexcept {
+    position_ = header_->head;
+    remaining_ = header_->records;
+}
+
+bool CaptureReader::next(Record& record) {
+    bool wrapped = false;
+    while (remaining_ > 0) {
+        RecordHeader header{};
+        const bool fits = data_bytes_ - position_ >= sizeof(header);
+        if (fits) {
+            std::memcpy(&header, data_ + position_, sizeof(header));
+        }
+        if (!fits || (header.flags & capture::kRecordWrap)) {
+            if (wrapped || position_ == 0) {
+                throw std::runtime_error("Capture file is corrupt: wrap marker loop");
+            }
+            wrapped = true;
+            position_ = 0;
+            continue;
+        }
+
+        const std::size_t bytes = recordBytes(header.length, header.flags);
+        if (bytes > data_bytes_ - position_) {
+            throw std::runtime_error("Capture file is corrupt: record overruns the file");
+        }
+        const uint8_t* payload = data_ + position_ + sizeof(header);
+        record.timestamp_ns = header.timestamp_ns;
+        record.channel = header.channel;
+        record.length = header.length;
+        record.tx = (header.flags & capture::kRecordHasTx) ? payload : nullptr;
+        record.rx = (header.flags & capture::kRecordHasRx)
+                        ? payload + ((header.flags & capture::kRecordHasTx) ? header.length : 0)
+                        : nullptr;
+        position_ += bytes;
+        --remaining_;
+        return true;
+    }
+    return false;
+}
+
+} // namespace spi_eak
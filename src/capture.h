@@ -0,0 +1,158 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace spi_eak {
+
+/**
+ * On-disk layout shared by CaptureWriter and CaptureReader.
+ *
+ * A capture file is a FileHeader followed by a data region of
+ * `capacity` bytes holding RecordHeader + TX bytes + RX bytes, each record
+ * padded to 8 bytes. All fields are host-endian.
+ */
+namespace capture {
+
+constexpr char kMagic[8] = {'S', 'P', 'I', 'C', 'A', 'P', '0', '1'};
+constexpr uint32_t kVersion = 1;
+
+constexpr uint32_t kFileRing = 1u << 0; // data region wraps, oldest records are overwritten
+
+constexpr uint8_t kRecordHasTx = 1u << 0;
+constexpr uint8_t kRecordHasRx = 1u << 1;
+constexpr uint8_t kRecordWrap = 1u << 7; // marker: continue at the start of the data region
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t capacity;         // data region size in bytes
+    uint64_t head;             // offset of the oldest record
+    uint64_t tail;             // offset one past the newest record
+    uint64_t records;          // records between head and tail
+    uint64_t records_dropped;  // did not fit (append mode) or were larger than the ring
+    uint64_t records_overwritten;
+    uint64_t start_monotonic_ns;
+    uint64_t start_realtime_ns; // wall clock at creation, to line captures up with logs
+};
+
+struct RecordHeader {
+    uint64_t timestamp_ns; // CLOCK_MONOTONIC when the ioctl returned
+    uint32_t length;       // bytes per direction
+    uint16_t channel;      // tag passed to SPI::attachCapture
+    uint8_t flags;
+    uint8_t reserved;
+};
+
+static_assert(sizeof(FileHeader) % 8 == 0, "FileHeader must keep records 8-byte aligned");
+static_assert(sizeof(RecordHeader) == 16, "RecordHeader layout is part of the file format");
+
+} // namespace capture
+
+/**
+ * Appends timestamped TX/RX records to an mmap-backed file.
+ *
+ * The file is sized to `capacity_bytes` up front and mapped shared, so
+ * recording is a memcpy into the page cache with no syscalls; the data
+ * survives a crash of the recording process. In append mode the capture
+ * stops (counting drops) when full; in ring mode the oldest records are
+ * overwritten so the file always holds the most recent traffic.
+ *
+ * record() is serialised by an internal mutex, so one writer may be
+ * attached to several SPI handles.
+ */
+class CaptureWriter {
+public:
+    struct Options {
+        std::size_t capacity_bytes = 64u << 20; // data region size
+        bool ring = false;                       // overwrite oldest instead of stopping when full
+    };
+
+    /**
+     * Create (or truncate) `path` and map it.
+     * Throws std::runtime_error on failure.
+     */
+    explicit CaptureWriter(const std::string& path);
+    CaptureWriter(const std::string& path, const Options& options);
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    /**
+     * Append one transfer. Either buffer may be null. Returns false when the
+     * record was dropped (append mode full, or larger than the ring).
+     */
+    bool record(const uint8_t* tx, const uint8_t* rx, std::size_t length, uint16_t channel = 0);
+
+    /**
+     * Schedule dirty pages for writeback (msync MS_ASYNC).
+     */
+    void flush();
+
+    [[nodiscard]] uint64_t records() const;
+    [[nodiscard]] uint64_t recordsDropped() const;
+    [[nodiscard]] std::size_t capacity() const noexcept { return capacity_; }
+
+private:
+    uint8_t* reserve(std::size_t bytes) noexcept;
+    void evictOldest() noexcept;
+
+    int fd_ = -1;
+    uint8_t* map_ = nullptr;
+    std::size_t map_bytes_ = 0;
+    std::size_t capacity_ = 0;
+    capture::FileHeader* header_ = nullptr;
+    uint8_t* data_ = nullptr;
+    mutable std::mutex mutex_;
+};
+
+/**
+ * Read-only view of a capture file, iterated oldest to newest.
+ */
+class CaptureReader {
+public:
+    struct Record {
+        uint64_t timestamp_ns = 0;
+        uint16_t channel = 0;
+        std::size_t length = 0;
+        const uint8_t* tx = nullptr; // null when not captured
+        const uint8_t* rx = nullptr;
+    };
+
+    /**
+     * Map `path`. Throws std::runtime_error if it is missing or malformed.
+     */
+    explicit CaptureReader(const std::string& path);
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    /**
+     * Fetch the next record; false at the end. Pointers stay valid for the
+     * reader's lifetime.
+     */
+    bool next(Record& record);
+    void rewind() noexcept;
+
+    [[nodiscard]] const capture::FileHeader& header() const noexcept { return *header_; }
+    [[nodiscard]] uint64_t records() const noexcept { return header_->records; }
+
+private:
+    uint8_t* map_ = nullptr;
+    std::size_t map_bytes_ = 0;
+    const capture::FileHeader* header_ = nullptr;
+    const uint8_t* data_ = nullptr;
+    std::size_t data_bytes_ = 0; // mapped part of the data region
+    std::size_t position_ = 0;
+    uint64_t remaining_ = 0;
+};
+
+} // namespace spi_eak
+
+#endif // CAPTURE_H
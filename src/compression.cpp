@@ -0,0 +1,412 @@
+#include "compression.h"
+
+#include <array>
+#include <cstring>
+
+namespace spi_eak {
+namespace compress {
+
+namespace {
+
+constexpr std::size_t kMinMatch = 4;
+constexpr std::size_t kMaxOffset = 65535;
+constexpr unsigned kHashBits = 10; // small table: cheap to clear for short frames
+constexpr std::size_t kMaxRun = 130;      // 3..130 repeats per RLE run
+constexpr std::size_t kMaxLiterals = 128; // 1..128 bytes per RLE literal block
+constexpr std::size_t kMaxStride = 8;
+
+uint32_t read32(const uint8_t* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint32_t hash4(uint32_t value) {
+    return (value * 2654435761u) >> (32 - kHashBits);
+}
+
+// LZ lengths: 4-bit nibble in the token, 15 means "add the following bytes,
+// each 255 continues".
+bool putLength(uint8_t*& out, const uint8_t* end, std::size_t extra) {
+    while (extra >= 255) {
+        if (out == end) {
+            return false;
+        }
+        *out++ = 255;
+        extra -= 255;
+    }
+    if (out == end) {
+        return false;
+    }
+    *out++ = static_cast<uint8_t>(extra);
+    return true;
+}
+
+bool getLength(const uint8_t*& in, const uint8_t* end, std::size_t& length) {
+    while (true) {
+        if (in == end) {
+            return false;
+        }
+        const uint8_t byte = *in++;
+        length += byte;
+        if (byte != 255) {
+            return true;
+        }
+    }
+}
+
+bool putSequence(uint8_t*& out,
+                 const uint8_t* end,
+                 const uint8_t* literals,
+                 std::size_t literal_count,
+                 std::size_t offset,
+                 std::size_t match) {
+    if (out == end) {
+        return false;
+    }
+    uint8_t* token = out++;
+    *token = static_cast<uint8_t>((literal_count < 15 ? literal_count : 15) << 4);
+    if (literal_count >= 15 && !putLength(out, end, literal_count - 15)) {
+        return false;
+    }
+    if (static_cast<std::size_t>(end - out) < literal_count) {
+        return false;
+    }
+    std::memcpy(out, literals, literal_count);
+    out += literal_count;
+    if (match == 0) {
+        return true; // final literals-only sequence
+    }
+
+    if (end - out < 2) {
+        return false;
+    }
+    *out++ = static_cast<uint8_t>(offset & 0xFF);
+    *out++ = static_cast<uint8_t>(offset >> 8);
+    const std::size_t match_code = match - kMinMatch;
+    *token |= static_cast<uint8_t>(match_code < 15 ? match_code : 15);
+    return match_code < 15 || putLength(out, end, match_code - 15);
+}
+
+bool putVarint(uint8_t*& out, const uint8_t* end, uint64_t value) {
+    do {
+        if (out == end) {
+            return false;
+        }
+        const uint8_t low = static_cast<uint8_t>(value & 0x7F);
+        value >>= 7;
+        *out++ = static_cast<uint8_t>(low | (value ? 0x80 : 0));
+    } while (value);
+    return true;
+}
+
+bool getVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (in == end) {
+            return false;
+        }
+        const uint8_t byte = *in++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool putLiterals(uint8_t*& out,
+                 const uint8_t* end,
+                 const uint8_t* in,
+                 std::size_t first,
+                 std::size_t count,
+                 std::size_t stride) {
+    std::size_t index = first;
+    while (count > 0) {
+        const std::size_t block = count < kMaxLiterals ? count : kMaxLiterals;
+        if (static_cast<std::size_t>(end - out) < block + 1) {
+            return false;
+        }
+        *out++ = static_cast<uint8_t>(block - 1);
+        for (std::size_t idx = 0; idx < block; ++idx, index += stride) {
+            *out++ = static_cast<uint8_t>(in[index] - (index >= stride ? in[index - stride] : 0));
+        }
+        count -= block;
+    }
+    return true;
+}
+
+} // namespace
+
+std::size_t lzCompress(const uint8_t* in, std::size_t length, uint8_t* out, std::size_t capacity) {
+    if (!in || !out || length == 0) {
+        return 0;
+    }
+    std::array<uint32_t, std::size_t{1} << kHashBits> table{};
+    uint8_t* cursor = out;
+    const uint8_t* const end = out + capacity;
+
+    std::size_t anchor = 0;
+    std::size_t pos = 0;
+    std::size_t misses = 0;
+    while (pos + kMinMatch <= length) {
+        const uint32_t sequence = read32(in + pos);
+        const uint32_t hash = hash4(sequence);
+        const std::size_t candidate = table[hash];
+        table[hash] = static_cast<uint32_t>(pos);
+
+        if (candidate >= pos || pos - candidate > kMaxOffset || read32(in + candidate) != sequence) {
+            // Skip faster through data that is not matching.
+            pos += 1 + (misses++ >> 5);
+            continue;
+        }
+        misses = 0;
+
+        std::size_t match = kMinMatch;
+        while (pos + match < length && in[candidate + match] == in[pos + match]) {
+            ++match;
+        }
+        if (!putSequence(cursor, end, in + anchor, pos - anchor, pos - candidate, match)) {
+            return 0;
+        }
+        pos += match;
+        anchor = pos;
+    }
+
+    if (anchor < length && !putSequence(cursor, end, in + anchor, length - anchor, 0, 0)) {
+        return 0;
+    }
+    return static_cast<std::size_t>(cursor - out);
+}
+
+Inflated lzDecompress(const uint8_t* in, std::size_t length, uint8_t* out, std::size_t capacity) {
+    Inflated result;
+    if (!in && length > 0) {
+        result.status = Status::Malformed;
+        return result;
+    }
+    const uint8_t* cursor = in;
+    const uint8_t* const end = in + length;
+    std::size_t written = 0;
+
+    while (cursor != end) {
+        const uint8_t token = *cursor++;
+        std::size_t literals = token >> 4;
+        if (literals == 15 && !getLength(cursor, end, literals)) {
+            result.status = Status::Malformed;
+            return result;
+        }
+        if (literals > static_cast<std::size_t>(end - cursor)) {
+            result.status = Status::Malformed;
+            return result;
+        }
+        if (literals > capacity - written) {
+            result.status = Status::TooLarge;
+            return result;
+        }
+        std::memcpy(out + written, cursor, literals);
+        cursor += literals;
+        written += literals;
+        if (cursor == end) {
+            break;
+        }
+
+        if (end - cursor < 2) {
+            result.status = Status::Malformed;
+            return result;
+        }
+        const std::size_t offset = static_cast<std::size_t>(cursor[0]) | (static_cast<std::size_t>(cursor[1]) << 8);
+        cursor += 2;
+        std::size_t match = token & 0x0F;
+        if (match == 15 && !getLength(cursor, end, match)) {
+            result.status = Status::Malformed;
+            return result;
+        }
+        match += kMinMatch;
+        if (offset == 0 || offset > written) {
+            result.status = Status::Malformed;
+            return result;
+        }
+        if (match > capacity - written) {
+            result.status = Status::TooLarge;
+            return result;
+        }
+
+        uint8_t* dest = out + written;
+        const uint8_t* source = dest - offset;
+        if (offset >= match) {
+            std::memcpy(dest, source, match);
+        } else {
+            // Overlapping copy repeats the last `offset` bytes.
+            for (std::size_t idx = 0; idx < match; ++idx) {
+                dest[idx] = source[idx];
+            }
+        }
+        written += match;
+    }
+
+    result.bytes = written;
+    return result;
+}
+
+std::size_t deltaRleCompress(const uint8_t* in,
+                             std::size_t length,
+                             std::size_t stride,
+                             uint8_t* out,
+                             std::size_t capacity) {
+    if (!in || !out || length == 0 || stride == 0 || stride > kMaxStride) {
+        return 0;
+    }
+    uint8_t* cursor = out;
+    const uint8_t* const end = out + capacity;
+    if (cursor == end) {
+        return 0;
+    }
+    *cursor++ = static_cast<uint8_t>(stride);
+    if (!putVarint(cursor, end, length)) {
+        return 0;
+    }
+
+    auto delta = [&](std::size_t index) {
+        return static_cast<uint8_t>(in[index] - (index >= stride ? in[index - stride] : 0));
+    };
+
+    // One plane per byte position; runs never cross planes.
+    for (std::size_t plane = 0; plane < stride && plane < length; ++plane) {
+        const std::size_t count = (length - plane + stride - 1) / stride;
+        std::size_t literal_start = 0;
+        std::size_t element = 0;
+        while (element < count) {
+            const uint8_t value = delta(plane + element * stride);
+            std::size_t run = 1;
+            while (element + run < count && run < kMaxRun && delta(plane + (element + run) * stride) == value) {
+                ++run;
+            }
+            if (run < 3) {
+                element += run;
+                continue;
+            }
+            if (!putLiterals(cursor, end, in, plane + literal_start * stride, element - literal_start, stride)) {
+                return 0;
+            }
+            if (end - cursor < 2) {
+                return 0;
+            }
+            *cursor++ = static_cast<uint8_t>(0x80 | (run - 3));
+            *cursor++ = value;
+            element += run;
+            literal_start = element;
+        }
+        if (!putLiterals(cursor, end, in, plane + literal_start * stride, count - literal_start, stride)) {
+            return 0;
+        }
+    }
+    return static_cast<std::size_t>(cursor - out);
+}
+
+Inflated deltaRleDecompress(const uint8_t* in, std::size_t length, uint8_t* out, std::size_t capacity) {
+    Inflated result;
+    result.status = Status::Malformed;
+    if (!in || length == 0) {
+        return result;
+    }
+    const uint8_t* cursor = in;
+    const uint8_t* const end = in + length;
+    const std::size_t stride = *cursor++;
+    uint64_t total = 0;
+    if (stride == 0 || stride > kMaxStride || !getVarint(cursor, end, total)) {
+        return result;
+    }
+    if (total > capacity) {
+        result.status = Status::TooLarge;
+        return result;
+    }
+
+    const std::size_t size = static_cast<std::size_t>(total);
+    for (std::size_t plane = 0; plane < stride && plane < size; ++plane) {
+        const std::size_t count = (size - plane + stride - 1) / stride;
+        std::size_t index = plane;
+        std::size_t element = 0;
+        while (element < count) {
+            if (cursor == end) {
+                return result;
+            }
+            const uint8_t control = *cursor++;
+            const bool run = (control & 0x80) != 0;
+            const std::size_t block = run ? (control & 0x7F) + 3u : control + 1u;
+            if (block > count - element || (run ? end - cursor < 1 : static_cast<std::size_t>(end - cursor) < block)) {
+                return result;
+            }
+            for (std::size_t idx = 0; idx < block; ++idx, index += stride) {
+                const uint8_t value = run ? *cursor : cursor[idx];
+                out[index] = static_cast<uint8_t>(value + (index >= stride ? out[index - stride] : 0));
+            }
+            cursor += run ? 1 : block;
+            element += block;
+        }
+    }
+    if (cursor != end) {
+        return result;
+    }
+
+    result.status = Status::Ok;
+    result.bytes = size;
+    return result;
+}
+
+std::size_t compressPayload(Method method,
+                            std::size_t stride,
+                            const uint8_t* in,
+                            std::size_t length,
+                            uint8_t* out,
+                            std::size_t capacity) {
+    if (capacity < length + 1) {
+        return 0;
+    }
+    // Anything that does not shrink goes out stored, so a frame grows by the
+    // flag byte at most.
+    std::size_t packed = 0;
+    if (length > 0) {
+        if (method == Method::Lz) {
+            packed = lzCompress(in, length, out + 1, length - 1);
+        } else if (method == Method::DeltaRle) {
+            packed = deltaRleCompress(in, length, stride, out + 1, length - 1);
+        }
+    }
+    if (packed == 0) {
+        out[0] = static_cast<uint8_t>(Method::Stored);
+        if (length > 0) {
+            std::memcpy(out + 1, in, length);
+        }
+        return length + 1;
+    }
+    out[0] = static_cast<uint8_t>(method);
+    return packed + 1;
+}
+
+Inflated decompressPayload(const uint8_t* in, std::size_t length, uint8_t* out, std::size_t capacity) {
+    Inflated result;
+    if (!in || length == 0) {
+        result.status = Status::Malformed;
+        return result;
+    }
+    switch (static_cast<Method>(in[0])) {
+        case Method::Stored:
+            if (length - 1 > capacity) {
+                result.status = Status::TooLarge;
+                return result;
+            }
+            std::memcpy(out, in + 1, length - 1);
+            result.bytes = length - 1;
+            return result;
+        case Method::Lz:
+            return lzDecompress(in + 1, length - 1, out, capacity);
+        case Method::DeltaRle:
+            return deltaRleDecompress(in + 1, length - 1, out, capacity);
+    }
+    result.status = Status::Malformed;
+    return result;
+}
+
+} // namespace compress
+} // namespace spi_eak
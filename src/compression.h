@@ -0,0 +1,78 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace spi_eak {
+namespace compress {
+
+/**
+ * Value of the flag byte that leads a compressed frame's payload.
+ */
+enum class Method : uint8_t {
+    Stored = 0,  // payload follows verbatim
+    Lz = 1,      // byte-oriented LZ77 (LZ4-style sequences, 64 KiB window)
+    DeltaRle = 2 // per-element delta across byte planes, then run-length coding
+};
+
+enum class Status {
+    Ok,
+    Malformed, // truncated or inconsistent compressed stream
+    TooLarge   // output would exceed the caller's capacity
+};
+
+struct Inflated {
+    Status status = Status::Ok;
+    std::size_t bytes = 0;
+};
+
+/**
+ * Compress `length` bytes into `out`. Returns the compressed size, or 0 when
+ * the result would not fit in `capacity` (pass capacity < length to reject
+ * anything that does not shrink).
+ */
+std::size_t lzCompress(const uint8_t* in, std::size_t length, uint8_t* out, std::size_t capacity);
+
+/**
+ * Decompress into `out`, never writing past `capacity`.
+ */
+Inflated lzDecompress(const uint8_t* in, std::size_t length, uint8_t* out, std::size_t capacity);
+
+/**
+ * For arrays of `stride`-byte little- or big-endian numbers (1..8): each
+ * byte is replaced by its difference from the same byte of the previous
+ * element, the differences are grouped by byte position so slowly changing
+ * high bytes become long zero runs, and the result is run-length coded.
+ * Returns 0 when the result would not fit in `capacity`.
+ */
+std::size_t deltaRleCompress(const uint8_t* in,
+                             std::size_t length,
+                             std::size_t stride,
+                             uint8_t* out,
+                             std::size_t capacity);
+
+Inflated deltaRleDecompress(const uint8_t* in, std::size_t length, uint8_t* out, std::size_t capacity);
+
+/**
+ * Write a flag byte plus the payload compressed with `method` into `out`,
+ * falling back to Method::Stored when compression does not shrink it.
+ * `capacity` must be at least length + 1. Returns the bytes written.
+ */
+std::size_t compressPayload(Method method,
+                            std::size_t stride,
+                            const uint8_t* in,
+                            std::size_t length,
+                            uint8_t* out,
+                            std::size_t capacity);
+
+/**
+ * Inverse of compressPayload(): reads the flag byte and expands the rest
+ * into `out`, bounded by `capacity`.
+ */
+Inflated decompressPayload(const uint8_t* in, std::size_t length, uint8_t* out, std::size_t capacity);
+
+} // namespace compress
+} // namespace spi_eak
+
+#endif // COMPRESSION_H
@@ -0,0 +1,408 @@
+#include "crc.h"
+
+#include <array>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPI_EAK_CRC_X86 1
+#define SPI_EAK_TARGET_CLMUL __attribute__((target("pclmul,ssse3")))
+#define SPI_EAK_TARGET_CRC32C __attribute__((target("sse4.2")))
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <arm_neon.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#define SPI_EAK_CRC_ARM64 1
+#if defined(__clang__)
+#define SPI_EAK_TARGET_CLMUL __attribute__((target("aes")))
+#define SPI_EAK_TARGET_CRC32C __attribute__((target("crc")))
+#else
+#define SPI_EAK_TARGET_CLMUL __attribute__((target("+crypto")))
+#define SPI_EAK_TARGET_CRC32C __attribute__((target("+crc")))
+#endif
+#endif
+
+namespace spi_eak {
+namespace crc {
+
+namespace {
+
+constexpr uint16_t kCrc16Poly = 0x1021;
+constexpr uint32_t kCrc32cPoly = 0x82F63B78; // reflected
+
+constexpr uint16_t crc16_entry(uint8_t idx) {
+    uint16_t crc = static_cast<uint16_t>(idx) << 8;
+    for (int i = 0; i < 8; ++i) {
+        if (crc & 0x8000) {
+            crc = static_cast<uint16_t>((crc << 1) ^ kCrc16Poly);
+        } else {
+            crc <<= 1;
+        }
+    }
+    return crc;
+}
+
+constexpr uint32_t crc32c_entry(uint8_t idx) {
+    uint32_t crc = idx;
+    for (int i = 0; i < 8; ++i) {
+        crc = (crc & 1) ? (crc >> 1) ^ kCrc32cPoly : crc >> 1;
+    }
+    return crc;
+}
+
+// tables[k][b] is the CRC of byte b followed by k zero bytes, starting from 0.
+constexpr std::array<std::array<uint16_t, 256>, 8> makeCrc16Tables() {
+    std::array<std::array<uint16_t, 256>, 8> tables{};
+    for (std::size_t idx = 0; idx < 256; ++idx) {
+        tables[0][idx] = crc16_entry(static_cast<uint8_t>(idx));
+    }
+    for (std::size_t k = 1; k < 8; ++k) {
+        for (std::size_t idx = 0; idx < 256; ++idx) {
+            const uint16_t prev = tables[k - 1][idx];
+            tables[k][idx] = static_cast<uint16_t>((prev << 8) ^ tables[0][prev >> 8]);
+        }
+    }
+    return tables;
+}
+
+constexpr std::array<std::array<uint32_t, 256>, 8> makeCrc32cTables() {
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for (std::size_t idx = 0; idx < 256; ++idx) {
+        tables[0][idx] = crc32c_entry(static_cast<uint8_t>(idx));
+    }
+    for (std::size_t k = 1; k < 8; ++k) {
+        for (std::size_t idx = 0; idx < 256; ++idx) {
+            const uint32_t prev = tables[k - 1][idx];
+            tables[k][idx] = (prev >> 8) ^ tables[0][prev & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr auto kCrc16Tables = makeCrc16Tables();
+constexpr auto kCrc32cTables = makeCrc32cTables();
+
+// x^n mod P for the CRC-16 generator, used to derive folding constants.
+constexpr uint64_t crc16XPowMod(unsigned n) {
+    uint32_t r = 1;
+    for (unsigned i = 0; i < n; ++i) {
+        r <<= 1;
+        if (r & 0x10000) {
+            r ^= 0x10000u | kCrc16Poly;
+        }
+    }
+    return r;
+}
+
+// Below this length the folding setup costs more than it saves.
+constexpr std::size_t kClmulMinLength = 64;
+
+#if defined(SPI_EAK_CRC_X86)
+
+// Polynomials live in __m128i with bit i holding the coefficient of x^i, so
+// each 16-byte block is byte-reversed on load (the first byte is the most
+// significant for this MSB-first CRC).
+SPI_EAK_TARGET_CLMUL
+inline __m128i loadReversed(const uint8_t* data, __m128i reverse) {
+    return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data)), reverse);
+}
+
+// Returns a value congruent to acc * x^D mod P, where k = {x^D, x^(D+64)} mod P.
+SPI_EAK_TARGET_CLMUL
+inline __m128i fold(__m128i acc, __m128i k) {
+    return _mm_xor_si128(_mm_clmulepi64_si128(acc, k, 0x11),
+                         _mm_clmulepi64_si128(acc, k, 0x00));
+}
+
+SPI_EAK_TARGET_CLMUL
+uint16_t crc16ClmulKernel(uint16_t crc, const uint8_t* data, std::size_t length) {
+    const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i k512 = _mm_set_epi64x(static_cast<long long>(crc16XPowMod(512 + 64)),
+                                        static_cast<long long>(crc16XPowMod(512)));
+    const __m128i k128 = _mm_set_epi64x(static_cast<long long>(crc16XPowMod(128 + 64)),
+                                        static_cast<long long>(crc16XPowMod(128)));
+
+    // A non-zero initial register is equivalent to xoring it into the first
+    // two message bytes, after which the CRC is just M(x) * x^16 mod P.
+    __m128i x0 = _mm_xor_si128(loadReversed(data, reverse),
+                               _mm_set_epi64x(static_cast<long long>(static_cast<uint64_t>(crc) << 48), 0));
+    __m128i x1 = loadReversed(data + 16, reverse);
+    __m128i x2 = loadReversed(data + 32, reverse);
+    __m128i x3 = loadReversed(data + 48, reverse);
+    const uint8_t* cursor = data + 64;
+    std::size_t remaining = length - 64;
+
+    // Four independent lanes hide the multiplier latency.
+    while (remaining >= 64) {
+        x0 = _mm_xor_si128(fold(x0, k512), loadReversed(cursor, reverse));
+        x1 = _mm_xor_si128(fold(x1, k512), loadReversed(cursor + 16, reverse));
+        x2 = _mm_xor_si128(fold(x2, k512), loadReversed(cursor + 32, reverse));
+        x3 = _mm_xor_si128(fold(x3, k512), loadReversed(cursor + 48, reverse));
+        cursor += 64;
+        remaining -= 64;
+    }
+
+    __m128i acc = _mm_xor_si128(fold(x0, k128), x1);
+    acc = _mm_xor_si128(fold(acc, k128), x2);
+    acc = _mm_xor_si128(fold(acc, k128), x3);
+    while (remaining >= 16) {
+        acc = _mm_xor_si128(fold(acc, k128), loadReversed(cursor, reverse));
+        cursor += 16;
+        remaining -= 16;
+    }
+
+    // acc is congruent to the consumed prefix; its CRC from a zero register
+    // equals the prefix CRC, and the tail continues from there.
+    alignas(16) uint8_t residue[16];
+    _mm_store_si128(reinterpret_cast<__m128i*>(residue), _mm_shuffle_epi8(acc, reverse));
+    const uint16_t folded = crc16SliceBy8(0, residue, sizeof(residue));
+    return crc16SliceBy8(folded, cursor, remaining);
+}
+
+SPI_EAK_TARGET_CRC32C
+uint32_t crc32cHardwareKernel(uint32_t state, const uint8_t* data, std::size_t length) {
+#if defined(__x86_64__)
+    uint64_t state64 = state;
+    while (length >= 8) {
+        uint64_t word;
+        __builtin_memcpy(&word, data, sizeof(word));
+        state64 = _mm_crc32_u64(state64, word);
+        data += 8;
+        length -= 8;
+    }
+    state = static_cast<uint32_t>(state64);
+#endif
+    while (length >= 4) {
+        uint32_t word;
+        __builtin_memcpy(&word, data, sizeof(word));
+        state = _mm_crc32_u32(state, word);
+        data += 4;
+        length -= 4;
+    }
+    while (length > 0) {
+        state = _mm_crc32_u8(state, *data++);
+        --length;
+    }
+    return state;
+}
+
+bool cpuHasClmul() {
+    return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+}
+
+bool cpuHasCrc32c() {
+    return __builtin_cpu_supports("sse4.2");
+}
+
+#elif defined(SPI_EAK_CRC_ARM64)
+
+SPI_EAK_TARGET_CLMUL
+inline uint8x16_t loadReversed(const uint8_t* data) {
+    const uint8x16_t bytes = vrev64q_u8(vld1q_u8(data));
+    return vextq_u8(bytes, bytes, 8);
+}
+
+SPI_EAK_TARGET_CLMUL
+inline uint8x16_t fold(uint8x16_t acc, uint64_t k_low, uint64_t k_high) {
+    const uint64x2_t lanes = vreinterpretq_u64_u8(acc);
+    const poly128_t high = vmull_p64(static_cast<poly64_t>(vgetq_lane_u64(lanes, 1)),
+                                     static_cast<poly64_t>(k_high));
+    const poly128_t low = vmull_p64(static_cast<poly64_t>(vgetq_lane_u64(lanes, 0)),
+                                    static_cast<poly64_t>(k_low));
+    return veorq_u8(vreinterpretq_u8_p128(high), vreinterpretq_u8_p128(low));
+}
+
+SPI_EAK_TARGET_CLMUL
+uint16_t crc16ClmulKernel(uint16_t crc, const uint8_t* data, std::size_t length) {
+    constexpr uint64_t k512_low = crc16XPowMod(512);
+    constexpr uint64_t k512_high = crc16XPowMod(512 + 64);
+    constexpr uint64_t k128_low = crc16XPowMod(128);
+    constexpr uint64_t k128_high = crc16XPowMod(128 + 64);
+
+    const uint64x2_t seed = vcombine_u64(vcreate_u64(0), vcreate_u64(static_cast<uint64_t>(crc) << 48));
+    uint8x16_t x0 = veorq_u8(loadReversed(data), vreinterpretq_u8_u64(seed));
+    uint8x16_t x1 = loadReversed(data + 16);
+    uint8x16_t x2 = loadReversed(data + 32);
+    uint8x16_t x3 = loadReversed(data + 48);
+    const uint8_t* cursor = data + 64;
+    std::size_t remaining = length - 64;
+
+    while (remaining >= 64) {
+        x0 = veorq_u8(fold(x0, k512_low, k512_high), loadReversed(cursor));
+        x1 = veorq_u8(fold(x1, k512_low, k512_high), loadReversed(cursor + 16));
+        x2 = veorq_u8(fold(x2, k512_low, k512_high), loadReversed(cursor + 32));
+        x3 = veorq_u8(fold(x3, k512_low, k512_high), loadReversed(cursor + 48));
+        cursor += 64;
+        remaining -= 64;
+    }
+
+    uint8x16_t acc = veorq_u8(fold(x0, k128_low, k128_high), x1);
+    acc = veorq_u8(fold(acc, k128_low, k128_high), x2);
+    acc = veorq_u8(fold(acc, k128_low, k128_high), x3);
+    while (remaining >= 16) {
+        acc = veorq_u8(fold(acc, k128_low, k128_high), loadReversed(cursor));
+        cursor += 16;
+        remaining -= 16;
+    }
+
+    const uint8x16_t swapped = vrev64q_u8(acc);
+    uint8_t residue[16];
+    vst1q_u8(residue, vextq_u8(swapped, swapped, 8));
+    const uint16_t folded = crc16SliceBy8(0, residue, sizeof(residue));
+    return crc16SliceBy8(folded, cursor, remaining);
+}
+
+SPI_EAK_TARGET_CRC32C
+uint32_t crc32cHardwareKernel(uint32_t state, const uint8_t* data, std::size_t length) {
+    while (length >= 8) {
+        uint64_t word;
+        __builtin_memcpy(&word, data, sizeof(word));
+        state = __crc32cd(state, word);
+        data += 8;
+        length -= 8;
+    }
+    while (length > 0) {
+        state = __crc32cb(state, *data++);
+        --length;
+    }
+    return state;
+}
+
+bool cpuHasClmul() {
+    return (getauxval(AT_HWCAP) & HWCAP_PMULL) != 0;
+}
+
+bool cpuHasCrc32c() {
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+}
+
+#else
+
+uint16_t crc16ClmulKernel(uint16_t crc, const uint8_t* data, std::size_t length) {
+    return crc16SliceBy8(crc, data, length);
+}
+
+uint32_t crc32cHardwareKernel(uint32_t state, const uint8_t* data, std::size_t length) {
+    return crc32cSliceBy8(state, data, length);
+}
+
+bool cpuHasClmul() {
+    return false;
+}
+
+bool cpuHasCrc32c() {
+    return false;
+}
+
+#endif
+
+Engine detectCrc16Engine() {
+    return cpuHasClmul() ? Engine::Clmul : Engine::SliceBy8;
+}
+
+Engine detectCrc32cEngine() {
+    return cpuHasCrc32c() ? Engine::Hardware : Engine::SliceBy8;
+}
+
+} // namespace
+
+uint16_t crc16Bytewise(uint16_t crc, const uint8_t* data, std::size_t length) {
+    for (std::size_t idx = 0; idx < length; ++idx) {
+        uint8_t tbl_idx = static_cast<uint8_t>((crc >> 8) ^ data[idx]);
+        crc = static_cast<uint16_t>((crc << 8) ^ kCrc16Tables[0][tbl_idx]);
+    }
+    return crc;
+}
+
+uint16_t crc16SliceBy8(uint16_t crc, const uint8_t* data, std::size_t length) {
+    while (length >= 8) {
+        const uint8_t b0 = static_cast<uint8_t>(data[0] ^ (crc >> 8));
+        const uint8_t b1 = static_cast<uint8_t>(data[1] ^ (crc & 0xFF));
+        crc = static_cast<uint16_t>(kCrc16Tables[7][b0] ^ kCrc16Tables[6][b1] ^
+                                    kCrc16Tables[5][data[2]] ^ kCrc16Tables[4][data[3]] ^
+                                    kCrc16Tables[3][data[4]] ^ kCrc16Tables[2][data[5]] ^
+                                    kCrc16Tables[1][data[6]] ^ kCrc16Tables[0][data[7]]);
+        data += 8;
+        length -= 8;
+    }
+    return crc16Bytewise(crc, data, length);
+}
+
+uint16_t crc16Clmul(uint16_t crc, const uint8_t* data, std::size_t length) {
+    static const bool supported = cpuHasClmul();
+    if (!supported || length < kClmulMinLength) {
+        return crc16SliceBy8(crc, data, length);
+    }
+    return crc16ClmulKernel(crc, data, length);
+}
+
+uint32_t crc32cSliceBy8(uint32_t state, const uint8_t* data, std::size_t length) {
+    while (length >= 8) {
+        const uint32_t one = (static_cast<uint32_t>(data[0]) |
+                              static_cast<uint32_t>(data[1]) << 8 |
+                              static_cast<uint32_t>(data[2]) << 16 |
+                              static_cast<uint32_t>(data[3]) << 24) ^ state;
+        state = kCrc32cTables[7][one & 0xFF] ^ kCrc32cTables[6][(one >> 8) & 0xFF] ^
+                kCrc32cTables[5][(one >> 16) & 0xFF] ^ kCrc32cTables[4][one >> 24] ^
+                kCrc32cTables[3][data[4]] ^ kCrc32cTables[2][data[5]] ^
+                kCrc32cTables[1][data[6]] ^ kCrc32cTables[0][data[7]];
+        data += 8;
+        length -= 8;
+    }
+    while (length > 0) {
+        state = (state >> 8) ^ kCrc32cTables[0][(state ^ *data++) & 0xFF];
+        --length;
+    }
+    return state;
+}
+
+uint32_t crc32cHardware(uint32_t state, const uint8_t* data, std::size_t length) {
+    static const bool supported = cpuHasCrc32c();
+    if (!supported) {
+        return crc32cSliceBy8(state, data, length);
+    }
+    return crc32cHardwareKernel(state, data, length);
+}
+
+uint16_t crc16Update(uint16_t crc, const uint8_t* data, std::size_t length) {
+    static const Engine engine = detectCrc16Engine();
+    if (engine == Engine::Clmul && length >= kClmulMinLength) {
+        return crc16ClmulKernel(crc, data, length);
+    }
+    return crc16SliceBy8(crc, data, length);
+}
+
+uint32_t crc32cUpdate(uint32_t state, const uint8_t* data, std::size_t length) {
+    static const Engine engine = detectCrc32cEngine();
+    if (engine == Engine::Hardware) {
+        return crc32cHardwareKernel(state, data, length);
+    }
+    return crc32cSliceBy8(state, data, length);
+}
+
+Engine crc16Engine() {
+    static const Engine engine = detectCrc16Engine();
+    return engine;
+}
+
+Engine crc32cEngine() {
+    static const Engine engine = detectCrc32cEngine();
+    return engine;
+}
+
+const char* engineName(Engine engine) {
+    switch (engine) {
+        case Engine::Bytewise:
+            return "bytewise";
+        case Engine::SliceBy8:
+            return "slice-by-8";
+        case Engine::Clmul:
+            return "clmul";
+        case Engine::Hardware:
+            return "hardware";
+    }
+    return "unknown";
+}
+
+} // namespace crc
+} // namespace spi_eak
@@ -0,0 +1,68 @@
+#ifndef CRC_H
+#define CRC_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace spi_eak {
+namespace crc {
+
+/**
+ * Implementation backing a checksum, chosen once at runtime from CPU features.
+ */
+enum class Engine {
+    Bytewise,  // one table lookup per byte
+    SliceBy8,  // eight tables, eight bytes per step
+    Clmul,     // PCLMULQDQ (x86) / PMULL (ARMv8) folding
+    Hardware   // SSE4.2 / ARMv8 CRC32C instructions
+};
+
+// CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, MSB-first, no final xor.
+constexpr uint16_t kCrc16Init = 0xFFFF;
+
+// CRC-32C (Castagnoli): reflected poly 0x82F63B78, init and final xor 0xFFFFFFFF.
+constexpr uint32_t kCrc32cInit = 0xFFFFFFFF;
+
+/**
+ * Continue a CRC-16 over more data. Feeding a message in pieces gives the
+ * same result as one call over the concatenation.
+ */
+uint16_t crc16Update(uint16_t crc, const uint8_t* data, std::size_t length);
+
+inline uint16_t crc16_ccitt(const uint8_t* data, std::size_t length) {
+    return crc16Update(kCrc16Init, data, length);
+}
+
+/**
+ * Continue a CRC-32C over more data. `state` is the raw register (start from
+ * kCrc32cInit); finish with crc32cFinalize().
+ */
+uint32_t crc32cUpdate(uint32_t state, const uint8_t* data, std::size_t length);
+
+constexpr uint32_t crc32cFinalize(uint32_t state) {
+    return state ^ 0xFFFFFFFF;
+}
+
+inline uint32_t crc32c(const uint8_t* data, std::size_t length) {
+    return crc32cFinalize(crc32cUpdate(kCrc32cInit, data, length));
+}
+
+[[nodiscard]] Engine crc16Engine();
+[[nodiscard]] Engine crc32cEngine();
+[[nodiscard]] const char* engineName(Engine engine);
+
+/**
+ * Individual kernels, exposed so benchmarks and self-checks can compare them
+ * against the dispatched entry points. Clmul/Hardware variants fall back to
+ * the table kernels when the CPU lacks the instructions.
+ */
+uint16_t crc16Bytewise(uint16_t crc, const uint8_t* data, std::size_t length);
+uint16_t crc16SliceBy8(uint16_t crc, const uint8_t* data, std::size_t length);
+uint16_t crc16Clmul(uint16_t crc, const uint8_t* data, std::size_t length);
+uint32_t crc32cSliceBy8(uint32_t state, const uint8_t* data, std::size_t length);
+uint32_t crc32cHardware(uint32_t state, const uint8_t* data, std::size_t length);
+
+} // namespace crc
+} // namespace spi_eak
+
+#endif // CRC_H
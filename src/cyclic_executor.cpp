@@ -0,0 +1,235 @@
+#include "cyclic_executor.h"
+#include "sys_util.h"
+
+#include <alloca.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include <cerrno>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace spi_eak {
+
+namespace {
+
+constexpr std::size_t kPageSize = 4096;
+
+void sleepUntil(uint64_t deadline_ns) {
+    timespec ts{};
+    ts.tv_sec = static_cast<time_t>(deadline_ns / detail::kNsPerSecond);
+    ts.tv_nsec = static_cast<long>(deadline_ns % detail::kNsPerSecond);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+}
+
+// Touch the stack the cycles will use so its pages are resident (and, after
+// mlockall, locked) before the first release rather than faulted in during
+// one.
+__attribute__((noinline)) void prefaultStack(std::size_t bytes) {
+    volatile uint8_t* stack = static_cast<volatile uint8_t*>(alloca(bytes));
+    for (std::size_t offset = 0; offset < bytes; offset += kPageSize) {
+        stack[offset] = 0;
+    }
+}
+
+} // namespace
+
+CyclicExecutor::CyclicExecutor(const Options& options)
+    : options_(options) {
+    if (options_.period.count() <= 0) {
+        throw std::invalid_argument("CyclicExecutor period must be positive");
+    }
+}
+
+CyclicExecutor::~CyclicExecutor() {
+    try {
+        stop();
+    } catch (...) {
+        // The loop's error has nowhere to go from a destructor.
+    }
+}
+
+std::size_t CyclicExecutor::add(SPI& spi, const std::vector<SPI::Segment>& segments) {
+    if (running_ || thread_.joinable()) {
+        throw std::logic_error("Cannot add transactions to a running CyclicExecutor");
+    }
+    transactions_.push_back(Transaction{&spi, spi.compile(segments)});
+    return transactions_.size() - 1;
+}
+
+SPI::TransferPlan& CyclicExecutor::plan(std::size_t index) {
+    return transactions_.at(index).plan;
+}
+
+void CyclicExecutor::onPrepare(Hook hook) {
+    if (running_ || thread_.joinable()) {
+        throw std::logic_error("Cannot change hooks of a running CyclicExecutor");
+    }
+    prepare_ = std::move(hook);
+}
+
+void CyclicExecutor::onComplete(Hook hook) {
+    if (running_ || thread_.joinable()) {
+        throw std::logic_error("Cannot change hooks of a running CyclicExecutor");
+    }
+    complete_ = std::move(hook);
+}
+
+void CyclicExecutor::start() {
+    if (running_ || thread_.joinable()) {
+        return;
+    }
+    running_ = true;
+    stop_requested_ = false;
+    error_ = nullptr;
+
+    std::promise<void> ready;
+    std::future<void> started = ready.get_future();
+    thread_ = std::thread([this, ready = std::move(ready)]() mutable {
+        try {
+            prepareThread();
+        } catch (...) {
+            running_ = false;
+            ready.set_exception(std::current_exception());
+            return;
+        }
+        ready.set_value();
+        loop(0);
+    });
+    try {
+        started.get();
+    } catch (...) {
+        thread_.join();
+        throw;
+    }
+}
+
+void CyclicExecutor::stop() {
+    stop_requested_ = true;
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+void CyclicExecutor::run(uint64_t cycles) {
+    if (running_ || thread_.joinable()) {
+        throw std::logic_error("CyclicExecutor is already running");
+    }
+    running_ = true;
+    stop_requested_ = false;
+    error_ = nullptr;
+    try {
+        prepareThread();
+    } catch (...) {
+        running_ = false;
+        throw;
+    }
+    if (cycles > 0) {
+        loop(cycles);
+    } else {
+        running_ = false;
+    }
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+CyclicExecutor::Stats CyclicExecutor::stats() const noexcept {
+    Stats snap;
+    snap.cycles = cycles_.load(std::memory_order_relaxed);
+    snap.overruns = overruns_.load(std::memory_order_relaxed);
+    snap.skipped = skipped_.load(std::memory_order_relaxed);
+    snap.transfer_errors = transfer_errors_.load(std::memory_order_relaxed);
+    snap.wake_latency = wake_latency_.snapshot();
+    snap.execution = execution_.snapshot();
+    return snap;
+}
+
+void CyclicExecutor::resetStats() noexcept {
+    cycles_.store(0, std::memory_order_relaxed);
+    overruns_.store(0, std::memory_order_relaxed);
+    skipped_.store(0, std::memory_order_relaxed);
+    transfer_errors_.store(0, std::memory_order_relaxed);
+    wake_latency_.reset();
+    execution_.reset();
+}
+
+void CyclicExecutor::prepareThread() {
+    applyThreadPolicy(options_.thread);
+    if (options_.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        const int err = errno;
+        throw std::runtime_error("Failed to lock memory: " + detail::errnoMessage(err));
+    }
+    if (options_.prefault_stack_bytes > 0) {
+        prefaultStack(options_.prefault_stack_bytes);
+    }
+}
+
+// `cycles` == 0 runs until stop().
+void CyclicExecutor::loop(uint64_t cycles) {
+    const uint64_t period = static_cast<uint64_t>(options_.period.count());
+    uint64_t release = detail::monotonicNs() + period;
+    uint64_t index = 0;
+    uint64_t executed = 0;
+    uint64_t skipped = 0;
+
+    try {
+        while (!stop_requested_.load(std::memory_order_relaxed) && (cycles == 0 || executed < cycles)) {
+            sleepUntil(release);
+            const uint64_t woke = detail::monotonicNs();
+
+            Cycle cycle;
+            cycle.index = index;
+            cycle.release_ns = release;
+            cycle.wake_latency_ns = woke > release ? woke - release : 0;
+            cycle.skipped = skipped;
+            runCycle(cycle);
+
+            const uint64_t finished = detail::monotonicNs();
+            wake_latency_.record(cycle.wake_latency_ns);
+            execution_.record(finished - woke);
+            cycles_.fetch_add(1, std::memory_order_relaxed);
+            ++executed;
+
+            skipped = 0;
+            if (finished > release + period) {
+                overruns_.fetch_add(1, std::memory_order_relaxed);
+                if (options_.overrun == Overrun::Skip) {
+                    // Resume at the first release still ahead of us.
+                    skipped = (finished - release) / period;
+                    skipped_.fetch_add(skipped, std::memory_order_relaxed);
+                }
+            }
+            index += 1 + skipped;
+            release += (1 + skipped) * period;
+        }
+    } catch (...) {
+        error_ = std::current_exception();
+    }
+    running_ = false;
+}
+
+void CyclicExecutor::runCycle(Cycle& cycle) {
+    if (prepare_) {
+        prepare_(cycle);
+    }
+    for (Transaction& transaction : transactions_) {
+        try {
+            transaction.spi->execute(transaction.plan);
+        } catch (const std::runtime_error&) {
+            cycle.transfer_failed = true;
+            transfer_errors_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (complete_) {
+        complete_(cycle);
+    }
+}
+
+} // namespace spi_eak
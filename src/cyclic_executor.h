@@ -0,0 +1,151 @@
+#ifndef CYCLIC_EXECUTOR_H
+#define CYCLIC_EXECUTOR_H
+
+#include "metrics.h"
+#include "realtime.h"
+#include "spi.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace spi_eak {
+
+/**
+ * Runs a fixed set of transactions once per period, for control loops.
+ *
+ * Cycles are released on an absolute CLOCK_MONOTONIC grid
+ * (clock_nanosleep with TIMER_ABSTIME), so a late wake-up or a long cycle
+ * never shifts the ones after it. Every transaction is a TransferPlan
+ * compiled when it is added; a cycle is the prepare hook (fill TX), one
+ * ioctl per transaction in registration order, then the complete hook
+ * (consume RX). Nothing on that path allocates.
+ *
+ * A cycle that ends after the next release time is an overrun. With
+ * Overrun::Skip the releases it ran over are dropped and the loop realigns
+ * to the grid; with Overrun::CatchUp they run back to back until the loop
+ * is on time again.
+ *
+ * Wake-up latency (release to start of the cycle), execution time and
+ * overruns are recorded every cycle and may be read from any thread.
+ * Transfer failures are counted and flagged to the complete hook without
+ * stopping the loop; an exception from a hook stops it and is rethrown by
+ * stop() (or run()).
+ */
+class CyclicExecutor {
+public:
+    enum class Overrun {
+        Skip,   // drop the missed releases, stay on the grid
+        CatchUp // run every release, late ones back to back
+    };
+
+    struct Options {
+        std::chrono::nanoseconds period{1'000'000};
+        Overrun overrun = Overrun::Skip;
+        ThreadPolicy thread;                      // CPU and SCHED_FIFO priority of the cycle thread
+        bool lock_memory = false;                 // mlockall(MCL_CURRENT | MCL_FUTURE) before the first cycle
+        std::size_t prefault_stack_bytes = 64 * 1024; // stack touched before the first cycle
+    };
+
+    struct Cycle {
+        uint64_t index = 0;          // release number since start
+        uint64_t release_ns = 0;     // scheduled start, CLOCK_MONOTONIC
+        uint64_t wake_latency_ns = 0;
+        uint64_t skipped = 0;        // releases dropped just before this one
+        bool transfer_failed = false; // complete hook only: some transaction threw
+    };
+
+    using Hook = std::function<void(const Cycle&)>;
+
+    struct Stats {
+        uint64_t cycles = 0;
+        uint64_t overruns = 0;
+        uint64_t skipped = 0;         // releases dropped under Overrun::Skip
+        uint64_t transfer_errors = 0;
+        LatencyHistogram::Snapshot wake_latency;
+        LatencyHistogram::Snapshot execution;
+    };
+
+    /**
+     * Throws std::invalid_argument for a non-positive period.
+     */
+    explicit CyclicExecutor(const Options& options);
+    ~CyclicExecutor();
+
+    CyclicExecutor(const CyclicExecutor&) = delete;
+    CyclicExecutor& operator=(const CyclicExecutor&) = delete;
+
+    /**
+     * Register a transaction on `spi`, which must outlive the executor.
+     * Returns its index. Throws std::logic_error while running.
+     */
+    std::size_t add(SPI& spi, const std::vector<SPI::Segment>& segments);
+
+    /**
+     * The compiled plan of transaction `index`, to repoint buffers or change
+     * lengths. Only touch it while stopped or from a hook.
+     */
+    [[nodiscard]] SPI::TransferPlan& plan(std::size_t index);
+
+    void onPrepare(Hook hook);   // before the transfers: fill TX buffers
+    void onComplete(Hook hook);  // after the transfers: consume RX buffers
+
+    /**
+     * Run cycles on a background thread until stop(). Throws
+     * std::runtime_error, without starting, when the thread policy or
+     * mlockall is refused.
+     */
+    void start();
+
+    /**
+     * Finish the current cycle and join. Rethrows the exception that ended
+     * the loop, if any.
+     */
+    void stop();
+
+    /**
+     * Execute `cycles` cycles on the calling thread, which gets the thread
+     * policy. Same errors as start() and stop().
+     */
+    void run(uint64_t cycles);
+
+    [[nodiscard]] bool running() const noexcept { return running_.load(std::memory_order_relaxed); }
+    [[nodiscard]] Stats stats() const noexcept;
+    void resetStats() noexcept;
+
+private:
+    struct Transaction {
+        SPI* spi;
+        SPI::TransferPlan plan;
+    };
+
+    void prepareThread();
+    void loop(uint64_t cycles);
+    void runCycle(Cycle& cycle);
+
+    Options options_;
+    std::vector<Transaction> transactions_;
+    Hook prepare_;
+    Hook complete_;
+
+    std::atomic<bool> running_{false};
+    std::atomic<bool> stop_requested_{false};
+    std::thread thread_;
+    std::exception_ptr error_;
+
+    std::atomic<uint64_t> cycles_{0};
+    std::atomic<uint64_t> overruns_{0};
+    std::atomic<uint64_t> skipped_{0};
+    std::atomic<uint64_t> transfer_errors_{0};
+    LatencyHistogram wake_latency_;
+    LatencyHistogram execution_;
+};
+
+} // namespace spi_eak
+
+#endif // CYCLIC_EXECUTOR_H
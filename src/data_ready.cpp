@@ -0,0 +1,256 @@
+#include "data_ready.h"
+#include "sys_util.h"
+
+#include <fcntl.h>
+#include <linux/gpio.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace spi_eak {
+
+DataReadyLine DataReadyLine::openGpio(const std::string& chip_path,
+                                      uint32_t offset,
+                                      Edge edge,
+                                      const std::string& consumer) {
+    const int chip = ::open(chip_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (chip < 0) {
+        const int err = errno;
+        throw std::runtime_error("Failed to open GPIO chip '" + chip_path + "': " + detail::errnoMessage(err));
+    }
+
+    gpio_v2_line_request request;
+    std::memset(&request, 0, sizeof(request));
+    request.offsets[0] = offset;
+    request.num_lines = 1;
+    std::strncpy(request.consumer, consumer.c_str(), sizeof(request.consumer) - 1);
+    request.config.flags = GPIO_V2_LINE_FLAG_INPUT |
+                           (edge == Edge::Rising ? GPIO_V2_LINE_FLAG_EDGE_RISING
+                                                 : GPIO_V2_LINE_FLAG_EDGE_FALLING);
+    const int rc = ioctl(chip, GPIO_V2_GET_LINE_IOCTL, &request);
+    const int err = errno;
+    ::close(chip);
+    if (rc < 0) {
+        throw std::runtime_error("Failed to request GPIO line " + std::to_string(offset) + " on '" +
+                                 chip_path + "': " + detail::errnoMessage(err));
+    }
+
+    const int flags = fcntl(request.fd, F_GETFL);
+    if (flags < 0 || fcntl(request.fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        const int fcntl_err = errno;
+        ::close(request.fd);
+        throw std::runtime_error("Failed to make GPIO line non-blocking: " + detail::errnoMessage(fcntl_err));
+    }
+    return DataReadyLine(request.fd, true, edge);
+}
+
+DataReadyLine DataReadyLine::eventFd() {
+    const int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        const int err = errno;
+        throw std::runtime_error("Failed to create data-ready eventfd: " + detail::errnoMessage(err));
+    }
+    return DataReadyLine(fd, false, Edge::Rising);
+}
+
+DataReadyLine::~DataReadyLine() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+DataReadyLine::DataReadyLine(DataReadyLine&& other) noexcept
+    : fd_(other.fd_)
+    , gpio_(other.gpio_)
+    , edge_(other.edge_) {
+    other.fd_ = -1;
+}
+
+DataReadyLine& DataReadyLine::operator=(DataReadyLine&& other) noexcept {
+    if (this != &other) {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        fd_ = other.fd_;
+        gpio_ = other.gpio_;
+        edge_ = other.edge_;
+        other.fd_ = -1;
+    }
+    return *this;
+}
+
+void DataReadyLine::signal() {
+    if (gpio_) {
+        throw std::logic_error("A GPIO data-ready line is raised by the peer, not by signal()");
+    }
+    const uint64_t one = 1;
+    if (::write(fd_, &one, sizeof(one)) != static_cast<ssize_t>(sizeof(one))) {
+        const int err = errno;
+        throw std::runtime_error("Failed to raise data-ready eventfd: " + detail::errnoMessage(err));
+    }
+}
+
+std::size_t DataReadyLine::consume(uint64_t* last_edge_ns) {
+    if (last_edge_ns) {
+        *last_edge_ns = 0;
+    }
+    if (!gpio_) {
+        uint64_t count = 0;
+        if (::read(fd_, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count))) {
+            return 0; // EAGAIN: nothing pending
+        }
+        return static_cast<std::size_t>(count);
+    }
+
+    std::size_t edges = 0;
+    gpio_v2_line_event events[16];
+    while (true) {
+        const ssize_t got = ::read(fd_, events, sizeof(events));
+        if (got <= 0) {
+            break;
+        }
+        const std::size_t count = static_cast<std::size_t>(got) / sizeof(events[0]);
+        edges += count;
+        if (last_edge_ns && count > 0) {
+            *last_edge_ns = events[count - 1].timestamp_ns;
+        }
+        if (count < sizeof(events) / sizeof(events[0])) {
+            break;
+        }
+    }
+    return edges;
+}
+
+bool DataReadyLine::active() const {
+    if (!gpio_) {
+        return false;
+    }
+    gpio_v2_line_values values;
+    std::memset(&values, 0, sizeof(values));
+    values.mask = 1;
+    if (ioctl(fd_, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0) {
+        const int err = errno;
+        throw std::runtime_error("Failed to read data-ready line: " + detail::errnoMessage(err));
+    }
+    const bool high = (values.bits & 1) != 0;
+    return edge_ == Edge::Rising ? high : !high;
+}
+
+bool DataReadyLine::wait(int timeout_ms) const {
+    pollfd pfd{};
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    return ::poll(&pfd, 1, timeout_ms) > 0 && (pfd.revents & POLLIN);
+}
+
+DataReadyReceiver::DataReadyReceiver(SPI& spi, DataReadyLine& line, const Options& options)
+    : DataReadyReceiver(Transfer([&spi](uint8_t* rx, const uint8_t* tx, std::size_t length) {
+                            spi.transfer(rx, tx, length);
+                        }),
+                        line, options) {}
+
+DataReadyReceiver::DataReadyReceiver(Transfer transfer, DataReadyLine& line, const Options& options)
+    : options_(options)
+    , transfer_(std::move(transfer))
+    , line_(line)
+    , decoder_(options.decoder) {
+    if (!transfer_) {
+        throw std::invalid_argument("DataReadyReceiver requires a transfer function");
+    }
+    if (options_.header_bytes != 1 && options_.header_bytes != 2 && options_.header_bytes != 4) {
+        throw std::invalid_argument("DataReadyReceiver header_bytes must be 1, 2 or 4");
+    }
+    if (options_.max_message_bytes == 0 || options_.max_announce_bytes == 0 || options_.max_reads_per_wake == 0) {
+        throw std::invalid_argument("DataReadyReceiver message sizes and read bound must be non-zero");
+    }
+    const std::size_t buffer_bytes = std::max(options_.max_message_bytes, options_.header_bytes);
+    header_all_ones_ = static_cast<std::size_t>((uint64_t{1} << (8 * options_.header_bytes)) - 1);
+    tx_fill_.assign(buffer_bytes, options_.fill_byte);
+    rx_buffer_.resize(buffer_bytes);
+    rx_frame_.reserve(options_.decoder.max_frame_bytes);
+}
+
+std::size_t DataReadyReceiver::readHeader() {
+    transfer_(rx_buffer_.data(), tx_fill_.data(), options_.header_bytes);
+    std::size_t announced = 0;
+    for (std::size_t idx = 0; idx < options_.header_bytes; ++idx) {
+        announced = (announced << 8) | rx_buffer_[idx];
+    }
+    return announced;
+}
+
+DataReadyReceiver::ReceiveResult DataReadyReceiver::handleReady(const FrameCallback& on_frame) {
+    ReceiveResult result;
+    uint64_t edge_ns = 0;
+    result.edges = line_.consume(&edge_ns);
+    if (result.edges == 0 && !resume_) {
+        return result;
+    }
+    resume_ = false;
+    if (edge_ns != 0) {
+        const uint64_t now = detail::monotonicNs();
+        result.wake_latency_ns = now > edge_ns ? now - edge_ns : 0;
+    }
+
+    const auto deliver = [&](const FrameDecoder::Result& frame_result) {
+        if (on_frame) {
+            on_frame(frame_result, rx_frame_);
+        }
+    };
+
+    // Keep reading while a level-sensitive line says the peer has more, so a
+    // burst queued behind one edge does not wait for the next one.
+    for (std::size_t reads = 0; reads < options_.max_reads_per_wake; ++reads) {
+        const std::size_t length = readHeader();
+        if (length == 0) {
+            return result;
+        }
+        if (length > options_.max_announce_bytes || length == header_all_ones_) {
+            // A corrupt or floating header says nothing about where the
+            // peer's data ends; drop any partial frame and wait for the
+            // next edge instead of clocking out up to 4 GiB.
+            ++result.bad_headers;
+            decoder_.reset();
+            return result;
+        }
+
+        // The whole announcement must be clocked out or the next header
+        // read lands mid-body; the decoder carries frames across pieces.
+        for (std::size_t left = length; left > 0;) {
+            const std::size_t piece = std::min(left, options_.max_message_bytes);
+            transfer_(rx_buffer_.data(), tx_fill_.data(), piece);
+            const auto summary = decoder_.decode(rx_buffer_.data(), piece, rx_frame_, deliver);
+            result.bytes_read += piece;
+            result.frames_received += summary.frames_ready;
+            result.frames_dropped += summary.frames_dropped;
+            left -= piece;
+        }
+        ++result.messages;
+
+        if (!line_.active()) {
+            return result;
+        }
+    }
+    // The line is still asserted, so the edge that would wake the caller
+    // again has already happened.
+    resume_ = true;
+    result.more = true;
+    return result;
+}
+
+DataReadyReceiver::ReceiveResult DataReadyReceiver::receive(int timeout_ms, const FrameCallback& on_frame) {
+    if (!resume_ && !line_.wait(timeout_ms)) {
+        return ReceiveResult{};
+    }
+    return handleReady(on_frame);
+}
+
+} // namespace spi_eak
@@ -0,0 +1,170 @@
+#ifndef DATA_READY_H
+#define DATA_READY_H
+
+#include "link_layer.h"
+#include "spi.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace spi_eak {
+
+/**
+ * A pollable "peer has data" signal.
+ *
+ * Either a GPIO character-device line requested for edge events (the
+ * peer's data-ready/IRQ pin), or an eventfd that software raises with
+ * signal() as a stand-in for tests and simulators. fd() is non-blocking and
+ * becomes readable when an edge is pending, so it can sit in any epoll loop.
+ */
+class DataReadyLine {
+public:
+    enum class Edge {
+        Rising, // line is active high
+        Falling // line is active low
+    };
+
+    /**
+     * Request `offset` on `chip_path` (e.g. "/dev/gpiochip0") as an input
+     * with edge detection. Throws std::runtime_error on failure.
+     */
+    static DataReadyLine openGpio(const std::string& chip_path,
+                                  uint32_t offset,
+                                  Edge edge,
+                                  const std::string& consumer = "spi-eak");
+
+    /**
+     * Software-raised line backed by an eventfd.
+     * Throws std::runtime_error on failure.
+     */
+    static DataReadyLine eventFd();
+
+    ~DataReadyLine();
+    DataReadyLine(DataReadyLine&& other) noexcept;
+    DataReadyLine& operator=(DataReadyLine&& other) noexcept;
+    DataReadyLine(const DataReadyLine&) = delete;
+    DataReadyLine& operator=(const DataReadyLine&) = delete;
+
+    [[nodiscard]] int fd() const noexcept { return fd_; }
+    [[nodiscard]] bool isGpio() const noexcept { return gpio_; }
+
+    /**
+     * Raise an eventfd line; throws std::logic_error on a GPIO line.
+     */
+    void signal();
+
+    /**
+     * Drain every pending edge without blocking; returns how many there were.
+     * For GPIO lines `last_edge_ns` receives the kernel timestamp
+     * (CLOCK_MONOTONIC) of the newest edge, otherwise 0.
+     */
+    std::size_t consume(uint64_t* last_edge_ns = nullptr);
+
+    /**
+     * Whether the line is still asserted (GPIO only; an eventfd is never
+     * level-active). Lets a receiver keep reading while the peer has more.
+     */
+    [[nodiscard]] bool active() const;
+
+    /**
+     * Block until an edge is pending or `timeout_ms` passes (-1 waits
+     * forever). Returns true when an edge is pending.
+     */
+    bool wait(int timeout_ms) const;
+
+private:
+    DataReadyLine(int fd, bool gpio, Edge edge) noexcept
+        : fd_(fd)
+        , gpio_(gpio)
+        , edge_(edge) {}
+
+    int fd_ = -1;
+    bool gpio_ = false;
+    Edge edge_ = Edge::Rising;
+};
+
+/**
+ * Event-driven receive path: instead of clocking dummy transfers to poll
+ * the peer, wait for its data-ready edge, then read a length header and
+ * exactly that many framed bytes, and feed them to a FrameDecoder.
+ *
+ * Wire protocol: on each edge, one transfer of header_bytes returns the
+ * number of framed bytes ready (big-endian; 0 means nothing), followed by
+ * that many bytes, clocked in transfers of at most max_message_bytes. TX
+ * carries fill_byte throughout. A length above max_announce_bytes, or all
+ * ones (an undriven MISO), is counted as a bad header and not read.
+ */
+class DataReadyReceiver {
+public:
+    using Transfer = std::function<void(uint8_t* rx, const uint8_t* tx, std::size_t length)>;
+
+    struct Options {
+        FrameDecoder::Options decoder;
+        std::size_t header_bytes = 2;          // 1, 2 or 4
+        std::size_t max_message_bytes = 4096;  // largest body transfer; longer bodies are read in pieces
+        std::size_t max_announce_bytes = 16384; // longer announcements are treated as corrupt headers
+        std::size_t max_reads_per_wake = 16;   // bound on re-reads while the line stays active
+        uint8_t fill_byte = 0x00;
+    };
+
+    using FrameCallback = std::function<void(const FrameDecoder::Result& result,
+                                             const std::vector<uint8_t>& payload)>;
+
+    struct ReceiveResult {
+        std::size_t edges = 0;           // edges consumed by this call
+        std::size_t messages = 0;        // non-empty announcements read in full
+        std::size_t bytes_read = 0;      // body bytes fed to the decoder
+        std::size_t frames_received = 0;
+        std::size_t frames_dropped = 0;
+        std::size_t bad_headers = 0;     // lengths above max_announce_bytes or all ones
+        uint64_t wake_latency_ns = 0;    // edge timestamp to first header read (GPIO only)
+        bool more = false;               // line still asserted after max_reads_per_wake; call again
+    };
+
+    /**
+     * The line must outlive the receiver.
+     */
+    DataReadyReceiver(SPI& spi, DataReadyLine& line, const Options& options);
+    DataReadyReceiver(Transfer transfer, DataReadyLine& line, const Options& options);
+
+    /**
+     * Add this to epoll/poll with EPOLLIN and call handleReady() when it fires.
+     */
+    [[nodiscard]] int fd() const noexcept { return line_.fd(); }
+
+    /**
+     * Consume pending edges and read everything the peer announces. Safe to
+     * call when nothing is pending (returns an empty result without any
+     * transfer). When the read bound is hit with the line still asserted no
+     * new edge will fire, so `more` is set and the next call resumes reading
+     * without one. Transfer errors propagate as exceptions.
+     */
+    ReceiveResult handleReady(const FrameCallback& on_frame);
+
+    /**
+     * Blocking convenience: wait up to `timeout_ms` for an edge (not at all
+     * while a previous call left `more` set), then handleReady(). Returns an
+     * empty result on timeout.
+     */
+    ReceiveResult receive(int timeout_ms, const FrameCallback& on_frame);
+
+private:
+    std::size_t readHeader();
+
+    Options options_;
+    Transfer transfer_;
+    DataReadyLine& line_;
+    FrameDecoder decoder_;
+    std::vector<uint8_t> tx_fill_;
+    std::vector<uint8_t> rx_buffer_;
+    std::vector<uint8_t> rx_frame_;
+    std::size_t header_all_ones_ = 0; // what a header reads as with MISO floating high
+    bool resume_ = false; // the last wake stopped at max_reads_per_wake with data pending
+};
+
+} // namespace spi_eak
+
+#endif // DATA_READY_H
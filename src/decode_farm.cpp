@@ -0,0 +1,226 @@
+#include "decode_farm.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace spi_eak {
+
+struct DecodeFarm::Channel {
+    Channel(const Options& options, std::size_t home)
+        : in_pool(options.chunk_queue_depth, options.chunk_bytes)
+        , out_pool(options.frame_queue_depth, options.decoder.max_frame_bytes)
+        , input(options.chunk_queue_depth)
+        , output(options.frame_queue_depth)
+        , decoder(options.decoder, out_pool)
+        , home_worker(home) {}
+
+    // Pools are declared first so they outlive every lease below.
+    FramePool in_pool;
+    FramePool out_pool;
+    SpscRing<FramePool::Buffer> input;  // submitter -> whichever worker runs the channel
+    SpscRing<FramePool::Buffer> output; // running worker -> consumer
+    FrameDecoder decoder;
+    FramePool::Buffer frame;
+    FrameDecoder::ResultCallback on_result;
+    const std::size_t home_worker;
+
+    // Set while the channel sits in a run queue or is being decoded; this is
+    // what keeps a channel on one worker at a time.
+    std::atomic<bool> scheduled{false};
+
+    std::atomic<uint64_t> bytes_decoded{0};
+    std::atomic<uint64_t> frames_ready{0};
+    std::atomic<uint64_t> frames_dropped{0};
+    std::atomic<uint64_t> steals{0};
+};
+
+DecodeFarm::DecodeFarm()
+    : DecodeFarm(Options{}) {}
+
+DecodeFarm::DecodeFarm(const Options& options)
+    : options_(options) {
+    if (options_.channels == 0) {
+        throw std::invalid_argument("DecodeFarm needs at least one channel");
+    }
+    if (options_.chunk_bytes == 0 || options_.chunk_queue_depth == 0 ||
+        options_.frame_queue_depth == 0 || options_.batch_chunks == 0) {
+        throw std::invalid_argument("DecodeFarm chunk, queue and batch sizes must be non-zero");
+    }
+    if (options_.workers == 0) {
+        const std::size_t hardware = std::max(1u, std::thread::hardware_concurrency());
+        options_.workers = std::min(options_.channels, hardware);
+    }
+
+    for (std::size_t idx = 0; idx < options_.workers; ++idx) {
+        // A channel is queued at most once, so channels slots never overflow.
+        run_queues_.push_back(std::make_unique<MpscRing<ChannelId>>(options_.channels));
+    }
+    for (ChannelId id = 0; id < options_.channels; ++id) {
+        auto channel = std::make_unique<Channel>(options_, id % options_.workers);
+        Channel* raw = channel.get();
+        raw->on_result = [raw](const FrameDecoder::Result& result) {
+            if (result.frame_ready && raw->output.tryPush(std::move(raw->frame))) {
+                detail::bump(raw->frames_ready);
+            } else {
+                detail::bump(raw->frames_dropped);
+            }
+        };
+        channels_.push_back(std::move(channel));
+    }
+
+    try {
+        for (std::size_t idx = 0; idx < options_.workers; ++idx) {
+            workers_.emplace_back([this, idx]() { workerLoop(idx); });
+        }
+    } catch (...) {
+        stop();
+        throw;
+    }
+}
+
+DecodeFarm::~DecodeFarm() {
+    stop();
+}
+
+void DecodeFarm::stop() {
+    stopping_.store(true);
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        wake_.notify_all();
+    }
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+DecodeFarm::Channel& DecodeFarm::channelAt(ChannelId channel) const {
+    if (channel >= channels_.size()) {
+        throw std::out_of_range("Unknown DecodeFarm channel");
+    }
+    return *channels_[channel];
+}
+
+bool DecodeFarm::submit(ChannelId id, const uint8_t* data, std::size_t length) {
+    Channel& channel = channelAt(id);
+    if (!data && length > 0) {
+        throw std::invalid_argument("DecodeFarm::submit needs a data pointer");
+    }
+    if (length == 0) {
+        return true;
+    }
+
+    // Only this thread acquires input buffers, so the count can only grow
+    // under us; the ring holds at least as many slots as the pool.
+    const std::size_t pieces = (length + options_.chunk_bytes - 1) / options_.chunk_bytes;
+    if (channel.in_pool.available() < pieces) {
+        return false;
+    }
+    for (std::size_t offset = 0; offset < length; offset += options_.chunk_bytes) {
+        const std::size_t bytes = std::min(options_.chunk_bytes, length - offset);
+        FramePool::Buffer chunk = channel.in_pool.acquire();
+        std::memcpy(chunk.data(), data + offset, bytes);
+        chunk.resize(bytes);
+        channel.input.tryPush(std::move(chunk));
+    }
+
+    // Pairs with the fence in runChannel(): either the running worker sees
+    // the new chunks, or we see the channel unscheduled and queue it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!channel.scheduled.exchange(true)) {
+        schedule(id);
+    }
+    return true;
+}
+
+bool DecodeFarm::tryPop(ChannelId channel, FramePool::Buffer& frame) {
+    return channelAt(channel).output.tryPop(frame);
+}
+
+DecodeFarm::ChannelStats DecodeFarm::stats(ChannelId id) const {
+    const Channel& channel = channelAt(id);
+    ChannelStats stats;
+    stats.bytes_decoded = channel.bytes_decoded.load(std::memory_order_relaxed);
+    stats.frames_ready = channel.frames_ready.load(std::memory_order_relaxed);
+    stats.frames_dropped = channel.frames_dropped.load(std::memory_order_relaxed);
+    stats.steals = channel.steals.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void DecodeFarm::schedule(ChannelId id) {
+    ChannelId queued = id;
+    run_queues_[channels_[id]->home_worker]->tryPush(std::move(queued));
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        wake_.notify_one(); // any worker will do: it steals if the channel is not its own
+    }
+}
+
+bool DecodeFarm::findWork(std::size_t worker, ChannelId& channel) {
+    const std::size_t count = run_queues_.size();
+    for (std::size_t offset = 0; offset < count; ++offset) {
+        if (run_queues_[(worker + offset) % count]->tryPop(channel)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void DecodeFarm::runChannel(std::size_t worker, ChannelId id) {
+    Channel& channel = *channels_[id];
+    if (worker != channel.home_worker) {
+        detail::bump(channel.steals);
+    }
+
+    FramePool::Buffer chunk;
+    for (std::size_t batch = 0; batch < options_.batch_chunks && channel.input.tryPop(chunk); ++batch) {
+        channel.decoder.decode(chunk.data(), chunk.size(), channel.frame, channel.on_result);
+        detail::bump(channel.bytes_decoded, chunk.size());
+        chunk.release();
+    }
+
+    channel.scheduled.store(false);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!channel.input.empty() && !channel.scheduled.exchange(true)) {
+        schedule(id); // batch limit reached or more chunks raced in
+    }
+}
+
+void DecodeFarm::workerLoop(std::size_t worker) {
+    if (worker < options_.worker_threads.size()) {
+        try {
+            applyThreadPolicy(options_.worker_threads[worker]);
+        } catch (...) {
+            // Keep decoding with default scheduling rather than losing a worker.
+        }
+    }
+
+    ChannelId channel = 0;
+    while (true) {
+        if (findWork(worker, channel)) {
+            runChannel(worker, channel);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        sleepers_.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (findWork(worker, channel)) {
+            sleepers_.fetch_sub(1);
+            lock.unlock();
+            runChannel(worker, channel);
+            continue;
+        }
+        if (stopping_.load()) {
+            sleepers_.fetch_sub(1);
+            break; // nothing left to decode
+        }
+        wake_.wait(lock);
+        sleepers_.fetch_sub(1);
+    }
+}
+
+} // namespace spi_eak
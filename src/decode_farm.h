@@ -0,0 +1,108 @@
+#ifndef DECODE_FARM_H
+#define DECODE_FARM_H
+
+#include "frame_pool.h"
+#include "link_layer.h"
+#include "realtime.h"
+#include "ring_buffer.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace spi_eak {
+
+/**
+ * Decodes several framed RX streams in parallel on a pool of worker threads.
+ *
+ * Each channel owns one FrameDecoder. Submitting RX bytes for a channel
+ * schedules the whole channel (its decoder plus every pending chunk) on its
+ * home worker; an idle worker steals scheduled channels from busy ones.
+ * A channel is only ever run by one worker at a time, so its frames come out
+ * in stream order. Decoded frames arrive in a per-channel lock-free queue as
+ * pooled buffers, so the steady state allocates nothing.
+ *
+ * Each channel supports one submitting thread and one consuming thread;
+ * different channels may use different threads.
+ */
+class DecodeFarm {
+public:
+    using ChannelId = std::size_t;
+
+    struct Options {
+        std::size_t channels = 8;
+        std::size_t workers = 0;                   // 0 -> min(channels, hardware threads)
+        FrameDecoder::Options decoder;             // applied to every channel
+        std::size_t chunk_bytes = 4096;            // RX bytes per queued chunk
+        std::size_t chunk_queue_depth = 64;        // queued chunks per channel
+        std::size_t frame_queue_depth = 256;       // undelivered frames per channel
+        std::size_t batch_chunks = 16;             // chunks decoded before a channel yields its worker
+        std::vector<ThreadPolicy> worker_threads;  // optional, indexed by worker
+    };
+
+    struct ChannelStats {
+        uint64_t bytes_decoded = 0;
+        uint64_t frames_ready = 0;
+        uint64_t frames_dropped = 0; // includes PoolExhausted when the consumer lags
+        uint64_t steals = 0;         // batches run by a worker other than the home one
+    };
+
+    DecodeFarm();
+    explicit DecodeFarm(const Options& options);
+
+    /**
+     * Decodes everything already submitted, then joins the workers.
+     */
+    ~DecodeFarm();
+
+    DecodeFarm(const DecodeFarm&) = delete;
+    DecodeFarm& operator=(const DecodeFarm&) = delete;
+
+    /**
+     * Queue RX bytes for `channel` (copied, split into chunk_bytes pieces).
+     * Returns false without queuing anything when the channel's chunk queue
+     * cannot take all of them.
+     * Throws std::out_of_range for an unknown channel.
+     */
+    bool submit(ChannelId channel, const uint8_t* data, std::size_t length);
+
+    /**
+     * Take the next decoded frame of `channel`. Returns false when none is
+     * ready. Releasing the buffer hands it back to the channel; release
+     * every frame before the farm is destroyed.
+     */
+    bool tryPop(ChannelId channel, FramePool::Buffer& frame);
+
+    [[nodiscard]] ChannelStats stats(ChannelId channel) const;
+    [[nodiscard]] std::size_t channelCount() const noexcept { return channels_.size(); }
+    [[nodiscard]] std::size_t workerCount() const noexcept { return workers_.size(); }
+
+private:
+    struct Channel;
+
+    void schedule(ChannelId channel);
+    bool findWork(std::size_t worker, ChannelId& channel);
+    void runChannel(std::size_t worker, ChannelId channel);
+    void workerLoop(std::size_t worker);
+    void stop();
+    Channel& channelAt(ChannelId channel) const;
+
+    Options options_;
+    std::vector<std::unique_ptr<Channel>> channels_;
+    std::vector<std::unique_ptr<MpscRing<ChannelId>>> run_queues_; // one per worker
+    std::vector<std::thread> workers_;
+
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    std::atomic<std::size_t> sleepers_{0};
+    std::atomic<bool> stopping_{false};
+};
+
+} // namespace spi_eak
+
+#endif // DECODE_FARM_H
@@ -0,0 +1,166 @@
+#include "device_session.h"
+
+#include <linux/spi/spidev.h>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+namespace spi_eak {
+
+/**
+ * What the fd is actually set to, guarded by one mutex that every handle's
+ * messages also take. A failed write leaves the field unknown so the next
+ * use writes it again.
+ */
+class SpiDeviceSession::Shared {
+public:
+    Shared(std::shared_ptr<SpiTransport> transport, const Options& options)
+        : transport(std::move(transport))
+        , options(options) {
+        if (!this->transport) {
+            throw std::invalid_argument("SpiDeviceSession transport must not be null");
+        }
+    }
+
+    int applyMode(uint8_t value) {
+        if (mode_known && mode == value) {
+            ++stats.writes_skipped;
+            return 0;
+        }
+        ++stats.mode_writes;
+        mode_known = transport->writeMode(value) == 0;
+        mode = value;
+        return mode_known ? 0 : -1;
+    }
+
+    int applyBits(uint8_t value) {
+        if (bits_known && bits == value) {
+            ++stats.writes_skipped;
+            return 0;
+        }
+        ++stats.bits_writes;
+        bits_known = transport->writeBitsPerWord(value) == 0;
+        bits = value;
+        return bits_known ? 0 : -1;
+    }
+
+    int applySpeed(uint32_t value) {
+        if (speed_known && speed == value) {
+            ++stats.writes_skipped;
+            return 0;
+        }
+        ++stats.speed_writes;
+        speed_known = transport->writeMaxSpeed(value) == 0;
+        speed = value;
+        return speed_known ? 0 : -1;
+    }
+
+    std::mutex mutex;
+    const std::shared_ptr<SpiTransport> transport;
+    const Options options;
+    Stats stats;
+
+private:
+    uint8_t mode = 0;
+    uint8_t bits = 0;
+    uint32_t speed = 0;
+    bool mode_known = false;
+    bool bits_known = false;
+    bool speed_known = false;
+};
+
+/**
+ * The transport behind one logical handle: remembers the settings its SPI
+ * asked for and brings the shared fd in line before each of its messages.
+ */
+class SpiDeviceSession::Channel : public SpiTransport {
+public:
+    explicit Channel(std::shared_ptr<Shared> shared)
+        : shared_(std::move(shared)) {}
+
+    int message(spi_ioc_transfer* ops, std::size_t count) override {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        if (mode_set_ && shared_->applyMode(mode_) < 0) {
+            return -1;
+        }
+        if (shared_->options.per_transfer_overrides) {
+            for (std::size_t idx = 0; ops && idx < count; ++idx) {
+                if (ops[idx].speed_hz == 0) {
+                    ops[idx].speed_hz = speed_;
+                }
+                if (ops[idx].bits_per_word == 0) {
+                    ops[idx].bits_per_word = bits_;
+                }
+            }
+        } else {
+            if (bits_set_ && shared_->applyBits(bits_) < 0) {
+                return -1;
+            }
+            if (speed_set_ && shared_->applySpeed(speed_) < 0) {
+                return -1;
+            }
+        }
+        ++shared_->stats.messages;
+        return shared_->transport->message(ops, count);
+    }
+
+    // The mode cannot travel with a transfer, so it is written now (when it
+    // differs) to surface errors at configure time, and re-asserted before
+    // each message in case another handle changed it in between.
+    int writeMode(uint8_t mode) override {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        mode_ = mode;
+        mode_set_ = true;
+        return shared_->applyMode(mode);
+    }
+
+    int writeBitsPerWord(uint8_t bits) override {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        bits_ = bits;
+        bits_set_ = true;
+        return shared_->options.per_transfer_overrides ? 0 : shared_->applyBits(bits);
+    }
+
+    int writeMaxSpeed(uint32_t hz) override {
+        std::lock_guard<std::mutex> lock(shared_->mutex);
+        speed_ = hz;
+        speed_set_ = true;
+        return shared_->options.per_transfer_overrides ? 0 : shared_->applySpeed(hz);
+    }
+
+    [[nodiscard]] std::size_t bufferSize() const override {
+        return shared_->transport->bufferSize();
+    }
+
+private:
+    std::shared_ptr<Shared> shared_;
+    uint8_t mode_ = 0;
+    uint8_t bits_ = 0;
+    uint32_t speed_ = 0;
+    bool mode_set_ = false;
+    bool bits_set_ = false;
+    bool speed_set_ = false;
+};
+
+SpiDeviceSession::SpiDeviceSession(const std::string& device)
+    : SpiDeviceSession(device, Options{}) {}
+
+SpiDeviceSession::SpiDeviceSession(const std::string& device, const Options& options)
+    : SpiDeviceSession(std::make_shared<SpidevTransport>(device), options) {}
+
+SpiDeviceSession::SpiDeviceSession(std::shared_ptr<SpiTransport> transport)
+    : SpiDeviceSession(std::move(transport), Options{}) {}
+
+SpiDeviceSession::SpiDeviceSession(std::shared_ptr<SpiTransport> transport, const Options& options)
+    : shared_(std::make_shared<Shared>(std::move(transport), options)) {}
+
+SPI SpiDeviceSession::open(const SPI::Config& config) {
+    return SPI(std::make_shared<Channel>(shared_), config);
+}
+
+SpiDeviceSession::Stats SpiDeviceSession::stats() const {
+    std::lock_guard<std::mutex> lock(shared_->mutex);
+    return shared_->stats;
+}
+
+} // namespace spi_eak
@@ -0,0 +1,78 @@
+#ifndef DEVICE_SESSION_H
+#define DEVICE_SESSION_H
+
+#include "spi.h"
+#include "spi_transport.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace spi_eak {
+
+/**
+ * One spidev fd shared by several logical SPI handles, each with its own
+ * Config (e.g. a sensor read in mode 3 at 10 MHz and a flash in mode 0 at
+ * 40 MHz on the same chip select).
+ *
+ * The session tracks the settings actually applied to the fd and, before
+ * each message, writes only the ones the sending handle needs that differ.
+ * With per_transfer_overrides (the default) speed and bits per word travel
+ * in every spi_ioc_transfer, which spidev honours up to the controller
+ * limit, so the only ioctl a switch between handles can cost is
+ * SPI_IOC_WR_MODE; switching between handles that differ only in speed or
+ * word size costs none. Turn it off to keep the device-wide speed and word
+ * size in step as well, also diffed.
+ *
+ * Messages from different handles are serialised, together with any mode
+ * switch they need, so handles may be used from different threads. The
+ * handles keep the shared state alive; the session object itself may go
+ * away first.
+ */
+class SpiDeviceSession {
+public:
+    struct Options {
+        bool per_transfer_overrides = true;
+    };
+
+    struct Stats {
+        uint64_t messages = 0;
+        uint64_t mode_writes = 0;
+        uint64_t bits_writes = 0;
+        uint64_t speed_writes = 0;
+        uint64_t writes_skipped = 0; // settings already in place
+    };
+
+    /**
+     * Open `device`. Throws std::runtime_error on failure.
+     */
+    explicit SpiDeviceSession(const std::string& device);
+    SpiDeviceSession(const std::string& device, const Options& options);
+
+    /**
+     * Share an existing transport, e.g. a SimulatedSpiDevice. Throws
+     * std::invalid_argument when it is null.
+     */
+    explicit SpiDeviceSession(std::shared_ptr<SpiTransport> transport);
+    SpiDeviceSession(std::shared_ptr<SpiTransport> transport, const Options& options);
+
+    /**
+     * A logical handle on the shared fd. It behaves like any SPI handle
+     * (setSpeed, reconfigure, plans, chunking...) without disturbing the
+     * others. `config.device` is ignored. Throws std::runtime_error if
+     * applying `config` fails.
+     */
+    [[nodiscard]] SPI open(const SPI::Config& config);
+
+    [[nodiscard]] Stats stats() const;
+
+private:
+    class Shared;
+    class Channel;
+
+    std::shared_ptr<Shared> shared_;
+};
+
+} // namespace spi_eak
+
+#endif // DEVICE_SESSION_H
@@ -0,0 +1,168 @@
+#include "frame_arena.h"
+#include "sys_util.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+
+namespace spi_eak {
+
+namespace {
+
+constexpr uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+constexpr std::size_t kCacheLine = 64;
+constexpr std::size_t kHugePageBytes = 2u << 20;
+
+constexpr uint64_t packHead(uint64_t tag, uint32_t index) {
+    return (tag << 32) | index;
+}
+
+} // namespace
+
+FrameArena::FrameArena()
+    : FrameArena(Options{}) {}
+
+FrameArena::FrameArena(const Options& options) {
+    std::vector<SizeClass> classes = options.classes;
+    if (classes.empty()) {
+        throw std::invalid_argument("FrameArena needs at least one size class");
+    }
+    for (const auto& size_class : classes) {
+        if (size_class.block_bytes == 0 || size_class.block_count == 0) {
+            throw std::invalid_argument("FrameArena size classes need a non-zero block size and count");
+        }
+        if (size_class.block_count >= kEmpty) {
+            throw std::invalid_argument("FrameArena block count exceeds 32-bit index range");
+        }
+    }
+    std::sort(classes.begin(), classes.end(),
+              [](const SizeClass& a, const SizeClass& b) { return a.block_bytes < b.block_bytes; });
+
+    class_count_ = classes.size();
+    slabs_.reset(new Slab[class_count_]);
+    for (std::size_t idx = 0; idx < class_count_; ++idx) {
+        Slab& slab = slabs_[idx];
+        slab.block_bytes = classes[idx].block_bytes;
+        slab.stride = (classes[idx].block_bytes + kCacheLine - 1) / kCacheLine * kCacheLine;
+        slab.count = classes[idx].block_count;
+        slab.next.reset(new std::atomic<uint32_t>[slab.count]);
+        region_bytes_ += slab.stride * slab.count;
+    }
+
+    // One mapping for every slab, pre-faulted so the first use of a block
+    // never takes a page fault on a real-time thread.
+    void* region = MAP_FAILED;
+    if (options.huge_pages) {
+        const std::size_t huge_bytes = (region_bytes_ + kHugePageBytes - 1) / kHugePageBytes * kHugePageBytes;
+        region = ::mmap(nullptr, huge_bytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+        if (region != MAP_FAILED) {
+            region_bytes_ = huge_bytes;
+            huge_pages_ = true;
+        }
+    }
+    if (region == MAP_FAILED) {
+        region = ::mmap(nullptr, region_bytes_, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (region == MAP_FAILED) {
+            const int err = errno;
+            throw std::runtime_error("Failed to map FrameArena region: " + detail::errnoMessage(err));
+        }
+        if (options.huge_pages) {
+            ::madvise(region, region_bytes_, MADV_HUGEPAGE); // best effort
+        }
+    }
+    region_ = static_cast<uint8_t*>(region);
+
+    uint8_t* cursor = region_;
+    for (std::size_t idx = 0; idx < class_count_; ++idx) {
+        Slab& slab = slabs_[idx];
+        slab.base = cursor;
+        cursor += slab.stride * slab.count;
+        slab.head.store(packHead(0, kEmpty), std::memory_order_relaxed);
+        for (std::size_t block = slab.count; block > 0; --block) {
+            release(slab, static_cast<uint32_t>(block - 1));
+        }
+    }
+}
+
+FrameArena::~FrameArena() {
+    ::munmap(region_, region_bytes_);
+}
+
+void* FrameArena::allocate(std::size_t bytes) noexcept {
+    for (std::size_t idx = 0; idx < class_count_; ++idx) {
+        Slab& slab = slabs_[idx];
+        if (slab.block_bytes < bytes) {
+            continue;
+        }
+        uint64_t head = slab.head.load(std::memory_order_acquire);
+        while (true) {
+            const uint32_t index = static_cast<uint32_t>(head & 0xFFFFFFFFu);
+            if (index == kEmpty) {
+                break; // try the next larger class
+            }
+            const uint32_t next = slab.next[index].load(std::memory_order_relaxed);
+            const uint64_t desired = packHead((head >> 32) + 1, next);
+            if (slab.head.compare_exchange_weak(head, desired,
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_acquire)) {
+                slab.available.fetch_sub(1, std::memory_order_relaxed);
+                return slab.base + slab.stride * index;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void FrameArena::deallocate(void* block) noexcept {
+    if (!block) {
+        return;
+    }
+    const auto* bytes = static_cast<const uint8_t*>(block);
+    for (std::size_t idx = 0; idx < class_count_; ++idx) {
+        Slab& slab = slabs_[idx];
+        if (bytes >= slab.base && bytes < slab.base + slab.stride * slab.count) {
+            release(slab, static_cast<uint32_t>(static_cast<std::size_t>(bytes - slab.base) / slab.stride));
+            return;
+        }
+    }
+}
+
+bool FrameArena::owns(const void* block) const noexcept {
+    const auto* bytes = static_cast<const uint8_t*>(block);
+    return bytes >= region_ && bytes < region_ + region_bytes_;
+}
+
+std::size_t FrameArena::blockBytes(std::size_t size_class) const {
+    if (size_class >= class_count_) {
+        throw std::out_of_range("FrameArena size class out of range");
+    }
+    return slabs_[size_class].block_bytes;
+}
+
+std::size_t FrameArena::available(std::size_t size_class) const {
+    if (size_class >= class_count_) {
+        throw std::out_of_range("FrameArena size class out of range");
+    }
+    return slabs_[size_class].available.load(std::memory_order_relaxed);
+}
+
+void FrameArena::release(Slab& slab, uint32_t index) noexcept {
+    uint64_t head = slab.head.load(std::memory_order_relaxed);
+    while (true) {
+        slab.next[index].store(static_cast<uint32_t>(head & 0xFFFFFFFFu), std::memory_order_relaxed);
+        const uint64_t desired = packHead((head >> 32) + 1, index);
+        if (slab.head.compare_exchange_weak(head, desired,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed)) {
+            slab.available.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+} // namespace spi_eak
@@ -0,0 +1,153 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace spi_eak {
+
+/**
+ * Slab allocator for frame and transfer buffers.
+ *
+ * All blocks are carved out of one mapping made (and pre-faulted) at
+ * construction, optionally backed by huge pages. Blocks come in a few size
+ * classes, each starting on a cache line; allocate() takes the smallest
+ * class with a free block and deallocate() returns it, both lock-free, so
+ * after startup the data path never reaches malloc. The arena must outlive
+ * every block it hands out.
+ */
+class FrameArena {
+public:
+    struct SizeClass {
+        std::size_t block_bytes = 0;
+        std::size_t block_count = 0;
+    };
+
+    struct Options {
+        std::vector<SizeClass> classes = {{256, 256}, {2048, 128}, {16384, 16}};
+        bool huge_pages = false; // try MAP_HUGETLB, then fall back to transparent huge pages
+    };
+
+    FrameArena();
+    explicit FrameArena(const Options& options);
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    /**
+     * Returns a block of at least `bytes`, or nullptr when no class that
+     * fits has a free block.
+     */
+    [[nodiscard]] void* allocate(std::size_t bytes) noexcept;
+
+    /**
+     * Return a block from allocate(); null is ignored. Any thread may call it.
+     */
+    void deallocate(void* block) noexcept;
+
+    [[nodiscard]] bool owns(const void* block) const noexcept;
+    [[nodiscard]] std::size_t classCount() const noexcept { return class_count_; }
+    [[nodiscard]] std::size_t blockBytes(std::size_t size_class) const;
+    [[nodiscard]] std::size_t available(std::size_t size_class) const;
+    [[nodiscard]] bool hugePages() const noexcept { return huge_pages_; }
+
+private:
+    struct Slab {
+        std::size_t block_bytes = 0;
+        std::size_t stride = 0;
+        std::size_t count = 0;
+        uint8_t* base = nullptr;
+        std::unique_ptr<std::atomic<uint32_t>[]> next;
+        // Free-list head: generation tag in the upper 32 bits guards against ABA.
+        std::atomic<uint64_t> head{0};
+        std::atomic<std::size_t> available{0};
+    };
+
+    void release(Slab& slab, uint32_t index) noexcept;
+
+    std::unique_ptr<Slab[]> slabs_;
+    std::size_t class_count_ = 0;
+    uint8_t* region_ = nullptr;
+    std::size_t region_bytes_ = 0;
+    bool huge_pages_ = false;
+};
+
+/**
+ * Standard allocator drawing from a FrameArena. Throws std::bad_alloc when
+ * the arena has no block large enough, so exhaustion is never silently
+ * served from the heap.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit ArenaAllocator(FrameArena& arena) noexcept
+        : arena_(&arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+        : arena_(other.arena()) {}
+
+    T* allocate(std::size_t count) {
+        static_assert(alignof(T) <= 64, "FrameArena blocks are cache-line aligned");
+        if (count > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        void* block = arena_->allocate(count * sizeof(T));
+        if (!block) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(block);
+    }
+
+    void deallocate(T* block, std::size_t) noexcept { arena_->deallocate(block); }
+
+    // Default-initialise instead of value-initialise, so resize() on a byte
+    // vector that is about to be overwritten does not zero it first.
+    template <typename U>
+    void construct(U* object) noexcept(std::is_nothrow_default_constructible<U>::value) {
+        ::new (static_cast<void*>(object)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* object, Args&&... args) {
+        ::new (static_cast<void*>(object)) U(std::forward<Args>(args)...);
+    }
+
+    [[nodiscard]] FrameArena* arena() const noexcept { return arena_; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return arena_ == other.arena(); }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept { return arena_ != other.arena(); }
+
+private:
+    FrameArena* arena_;
+};
+
+using ArenaVector = std::vector<uint8_t, ArenaAllocator<uint8_t>>;
+
+/**
+ * Empty arena-backed byte vector with `capacity` reserved up front.
+ */
+inline ArenaVector makeArenaVector(FrameArena& arena, std::size_t capacity) {
+    ArenaVector vector{ArenaAllocator<uint8_t>(arena)};
+    vector.reserve(capacity);
+    return vector;
+}
+
+} // namespace spi_eak
+
+#endif // FRAME_ARENA_H
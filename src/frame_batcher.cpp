@@ -0,0 +1,86 @@
+#include "frame_batcher.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace spi_eak {
+
+FrameBatcher::FrameBatcher(SPI& spi, const Options& options)
+    : FrameBatcher(Transfer([&spi](uint8_t* rx, const uint8_t* tx, std::size_t length) {
+                       spi.transfer(rx, tx, length);
+                   }),
+                   options) {}
+
+FrameBatcher::FrameBatcher(Transfer transfer, const Options& options)
+    : options_(options)
+    , transfer_(std::move(transfer)) {
+    if (!transfer_) {
+        throw std::invalid_argument("FrameBatcher requires a transfer function");
+    }
+    if (options_.buffer_bytes == 0) {
+        throw std::invalid_argument("FrameBatcher buffer_bytes must be non-zero");
+    }
+    tx_.resize(options_.buffer_bytes);
+    rx_.resize(options_.buffer_bytes);
+}
+
+bool FrameBatcher::append(const uint8_t* payload, std::size_t length) {
+    const FrameCodec::Parameters& params = options_.params;
+    auto encoded = FrameCodec::encodeInto(payload, length, tx_.data() + used_, tx_.size() - used_, params);
+    if (!encoded.ok && encoded.error == FrameCodec::EncodeError::BufferTooSmall && used_ > 0) {
+        flush();
+        encoded = FrameCodec::encodeInto(payload, length, tx_.data(), tx_.size(), params);
+    }
+    if (!encoded.ok) {
+        if (encoded.error == FrameCodec::EncodeError::BufferTooSmall) {
+            return false;
+        }
+        throw std::invalid_argument("FrameBatcher framing parameters are invalid");
+    }
+
+    if (frames_ == 0) {
+        oldest_ = Clock::now();
+    }
+    used_ += encoded.bytes_written;
+    ++frames_;
+    if (thresholdReached()) {
+        flush();
+    }
+    return true;
+}
+
+bool FrameBatcher::poll(Clock::time_point now) {
+    if (frames_ == 0 || now < deadline()) {
+        return false;
+    }
+    flush();
+    return true;
+}
+
+std::size_t FrameBatcher::flush() {
+    if (used_ == 0) {
+        return 0;
+    }
+    const std::size_t length = used_;
+    transfer_(rx_.data(), tx_.data(), length);
+    used_ = 0;
+    frames_ = 0;
+    if (options_.on_rx) {
+        options_.on_rx(rx_.data(), length);
+    }
+    return length;
+}
+
+FrameBatcher::Clock::time_point FrameBatcher::deadline() const noexcept {
+    if (frames_ == 0) {
+        return Clock::time_point::max();
+    }
+    return oldest_ + options_.max_delay;
+}
+
+bool FrameBatcher::thresholdReached() const noexcept {
+    return (options_.flush_bytes && used_ >= options_.flush_bytes) ||
+           (options_.flush_frames && frames_ >= options_.flush_frames);
+}
+
+} // namespace spi_eak
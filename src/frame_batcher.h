@@ -0,0 +1,86 @@
+#ifndef FRAME_BATCHER_H
+#define FRAME_BATCHER_H
+
+#include "link_layer.h"
+#include "spi.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace spi_eak {
+
+/**
+ * Coalesces many small frames into one SPI transfer.
+ *
+ * Frames are encoded back to back into a batch buffer, which is clocked out
+ * in a single transfer when it reaches flush_bytes or flush_frames, when the
+ * oldest queued frame has waited max_delay (Nagle-style; call poll()), or on
+ * an explicit flush(). The RX half of each batch is handed to on_rx, which
+ * typically passes it to FrameDecoder::decode to pull out every frame the
+ * peer sent in the same clocks.
+ */
+class FrameBatcher {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Transfer = std::function<void(uint8_t* rx, const uint8_t* tx, std::size_t length)>;
+    using RxHandler = std::function<void(const uint8_t* rx, std::size_t length)>;
+
+    struct Options {
+        FrameCodec::Parameters params;
+        std::size_t buffer_bytes = 4096;                // batch capacity; keep within spidev bufsiz
+        std::size_t flush_bytes = 1024;                 // 0 disables the byte threshold
+        std::size_t flush_frames = 32;                  // 0 disables the frame-count threshold
+        std::chrono::microseconds max_delay{500};       // latency bound for the oldest frame
+        RxHandler on_rx;                                // optional; receives each batch's RX
+    };
+
+    FrameBatcher(SPI& spi, const Options& options);
+    FrameBatcher(Transfer transfer, const Options& options);
+
+    /**
+     * Encode a payload into the batch, flushing first if it would not fit
+     * and afterwards if a threshold is reached. Returns false when a single
+     * encoded frame is larger than buffer_bytes. Throws std::invalid_argument
+     * for invalid framing parameters; transfer errors propagate.
+     */
+    bool append(const uint8_t* payload, std::size_t length);
+    bool append(const std::vector<uint8_t>& payload) { return append(payload.data(), payload.size()); }
+
+    /**
+     * Flush if the oldest queued frame has reached max_delay. Returns true
+     * when a transfer was issued.
+     */
+    bool poll(Clock::time_point now = Clock::now());
+
+    /**
+     * Send whatever is queued now. Returns the number of bytes clocked.
+     */
+    std::size_t flush();
+
+    /**
+     * Time by which poll() must run to honour max_delay
+     * (Clock::time_point::max() when nothing is queued).
+     */
+    [[nodiscard]] Clock::time_point deadline() const noexcept;
+
+    [[nodiscard]] std::size_t pendingBytes() const noexcept { return used_; }
+    [[nodiscard]] std::size_t pendingFrames() const noexcept { return frames_; }
+
+private:
+    bool thresholdReached() const noexcept;
+
+    Options options_;
+    Transfer transfer_;
+    std::vector<uint8_t> tx_;
+    std::vector<uint8_t> rx_;
+    std::size_t used_ = 0;
+    std::size_t frames_ = 0;
+    Clock::time_point oldest_{};
+};
+
+} // namespace spi_eak
+
+#endif // FRAME_BATCHER_H
@@ -0,0 +1,75 @@
+#include "frame_pool.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace spi_eak {
+
+namespace {
+
+constexpr uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+constexpr std::size_t kCacheLine = 64;
+
+constexpr uint64_t packHead(uint64_t tag, uint32_t index) {
+    return (tag << 32) | index;
+}
+
+} // namespace
+
+FramePool::FramePool(std::size_t buffer_count, std::size_t buffer_bytes)
+    : buffer_count_(buffer_count)
+    , buffer_bytes_(buffer_bytes)
+    , stride_((buffer_bytes + kCacheLine - 1) / kCacheLine * kCacheLine)
+    , head_(packHead(0, kEmpty))
+    , available_(0) {
+    if (buffer_count == 0 || buffer_bytes == 0) {
+        throw std::invalid_argument("FramePool needs a non-zero buffer count and size");
+    }
+    if (buffer_count >= kEmpty) {
+        throw std::invalid_argument("FramePool buffer count exceeds 32-bit index range");
+    }
+
+    // Each buffer starts on its own cache line so neighbours never share one.
+    storage_.resize(stride_ * buffer_count + kCacheLine);
+    next_.reset(new std::atomic<uint32_t>[buffer_count]);
+    for (std::size_t idx = buffer_count; idx > 0; --idx) {
+        release(static_cast<uint32_t>(idx - 1));
+    }
+}
+
+FramePool::Buffer FramePool::acquire() noexcept {
+    uint64_t head = head_.load(std::memory_order_acquire);
+    while (true) {
+        const uint32_t index = static_cast<uint32_t>(head & 0xFFFFFFFFu);
+        if (index == kEmpty) {
+            return Buffer{};
+        }
+        const uint32_t next = next_[index].load(std::memory_order_relaxed);
+        const uint64_t desired = packHead((head >> 32) + 1, next);
+        if (head_.compare_exchange_weak(head, desired,
+                                        std::memory_order_acq_rel,
+                                        std::memory_order_acquire)) {
+            available_.fetch_sub(1, std::memory_order_relaxed);
+            const std::uintptr_t base = reinterpret_cast<std::uintptr_t>(storage_.data());
+            const std::uintptr_t aligned = (base + kCacheLine - 1) & ~(std::uintptr_t{kCacheLine} - 1);
+            uint8_t* data = reinterpret_cast<uint8_t*>(aligned) + stride_ * index;
+            return Buffer{this, data, index};
+        }
+    }
+}
+
+void FramePool::release(uint32_t index) noexcept {
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    while (true) {
+        next_[index].store(static_cast<uint32_t>(head & 0xFFFFFFFFu), std::memory_order_relaxed);
+        const uint64_t desired = packHead((head >> 32) + 1, index);
+        if (head_.compare_exchange_weak(head, desired,
+                                        std::memory_order_release,
+                                        std::memory_order_relaxed)) {
+            available_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+} // namespace spi_eak
@@ -0,0 +1,127 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace spi_eak {
+
+/**
+ * Fixed-capacity pool of equally sized frame buffers.
+ * All storage is allocated up front; acquire/release are lock-free, so a
+ * buffer leased on the decode thread may be released from any other thread.
+ * The pool must outlive every Buffer it hands out.
+ */
+class FramePool {
+public:
+    /**
+     * Move-only lease on one pool buffer. Returns the buffer to the pool when
+     * destroyed, reassigned or explicitly released.
+     */
+    class Buffer {
+    public:
+        Buffer() = default;
+        ~Buffer() { release(); }
+
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+        Buffer(Buffer&& other) noexcept
+            : pool_(other.pool_)
+            , data_(other.data_)
+            , index_(other.index_)
+            , size_(other.size_) {
+            other.pool_ = nullptr;
+            other.data_ = nullptr;
+            other.size_ = 0;
+        }
+        Buffer& operator=(Buffer&& other) noexcept {
+            if (this != &other) {
+                release();
+                pool_ = other.pool_;
+                data_ = other.data_;
+                index_ = other.index_;
+                size_ = other.size_;
+                other.pool_ = nullptr;
+                other.data_ = nullptr;
+                other.size_ = 0;
+            }
+            return *this;
+        }
+
+        [[nodiscard]] explicit operator bool() const noexcept { return pool_ != nullptr; }
+        [[nodiscard]] uint8_t* data() noexcept { return data_; }
+        [[nodiscard]] const uint8_t* data() const noexcept { return data_; }
+        [[nodiscard]] std::size_t size() const noexcept { return size_; }
+        [[nodiscard]] std::size_t capacity() const noexcept;
+        [[nodiscard]] const uint8_t* begin() const noexcept { return data_; }
+        [[nodiscard]] const uint8_t* end() const noexcept { return data_ + size_; }
+
+        /**
+         * Set the number of valid bytes; must not exceed capacity().
+         */
+        void resize(std::size_t size) noexcept { size_ = size; }
+
+        void release() noexcept;
+
+    private:
+        friend class FramePool;
+        Buffer(FramePool* pool, uint8_t* data, uint32_t index) noexcept
+            : pool_(pool)
+            , data_(data)
+            , index_(index) {}
+
+        FramePool* pool_ = nullptr;
+        uint8_t* data_ = nullptr;
+        uint32_t index_ = 0;
+        std::size_t size_ = 0;
+    };
+
+    FramePool(std::size_t buffer_count, std::size_t buffer_bytes);
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    /**
+     * Lease a buffer. Returns an empty Buffer (false in boolean context) when
+     * every buffer is already leased.
+     */
+    [[nodiscard]] Buffer acquire() noexcept;
+
+    [[nodiscard]] std::size_t available() const noexcept {
+        return available_.load(std::memory_order_relaxed);
+    }
+    [[nodiscard]] std::size_t bufferCount() const noexcept { return buffer_count_; }
+    [[nodiscard]] std::size_t bufferBytes() const noexcept { return buffer_bytes_; }
+
+private:
+    void release(uint32_t index) noexcept;
+
+    std::size_t buffer_count_;
+    std::size_t buffer_bytes_;
+    std::size_t stride_;
+    std::vector<uint8_t> storage_;
+    std::unique_ptr<std::atomic<uint32_t>[]> next_;
+    // Free-list head: generation tag in the upper 32 bits guards against ABA.
+    std::atomic<uint64_t> head_;
+    std::atomic<std::size_t> available_;
+};
+
+inline std::size_t FramePool::Buffer::capacity() const noexcept {
+    return pool_ ? pool_->bufferBytes() : 0;
+}
+
+inline void FramePool::Buffer::release() noexcept {
+    if (pool_) {
+        pool_->release(index_);
+        pool_ = nullptr;
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
+
+} // namespace spi_eak
+
+#endif // FRAME_POOL_H
@@ -0,0 +1,95 @@
+#include "framed_link.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace spi_eak {
+
+FramedLink::FramedLink(SPI& spi, const Options& options)
+    : FramedLink(Transfer([&spi](uint8_t* rx, const uint8_t* tx, std::size_t length) {
+                     spi.transfer(rx, tx, length);
+                 }),
+                 options) {}
+
+FramedLink::FramedLink(Transfer transfer, const Options& options)
+    : options_(options)
+    , transfer_(std::move(transfer))
+    , decoder_(options.decoder) {
+    if (!transfer_) {
+        throw std::invalid_argument("FramedLink requires a transfer function");
+    }
+    if (options_.transfer_bytes == 0) {
+        throw std::invalid_argument("FramedLink transfer_bytes must be non-zero");
+    }
+    if (options_.tx_backlog_bytes == 0) {
+        throw std::invalid_argument("FramedLink tx_backlog_bytes must be non-zero");
+    }
+    if (!FrameCodec::isIdleFill(options_.fill_byte, options_.decoder.params)) {
+        throw std::invalid_argument("FramedLink fill byte would be read as frame data");
+    }
+    tx_backlog_.resize(options_.tx_backlog_bytes);
+    tx_buffer_.resize(options_.transfer_bytes);
+    rx_buffer_.resize(options_.transfer_bytes);
+    rx_frame_.reserve(options_.decoder.max_frame_bytes);
+}
+
+bool FramedLink::send(const uint8_t* payload, std::size_t length) {
+    const FrameCodec::Parameters& params = options_.decoder.params;
+    std::size_t needed = FrameCodec::maxEncodedSize(length, params);
+    if (needed > tx_backlog_.size() - tx_tail_) {
+        needed = FrameCodec::encodedSize(payload, length, params);
+        if (needed == 0) {
+            throw std::invalid_argument("FramedLink framing parameters are invalid");
+        }
+        if (needed > tx_backlog_.size() - pendingTxBytes()) {
+            return false;
+        }
+        if (needed > tx_backlog_.size() - tx_tail_) {
+            // Slide the unsent bytes to the front to make room at the tail.
+            std::memmove(tx_backlog_.data(), tx_backlog_.data() + tx_head_, pendingTxBytes());
+            tx_tail_ -= tx_head_;
+            tx_head_ = 0;
+        }
+    }
+
+    const auto encoded = FrameCodec::encodeInto(payload, length, tx_backlog_.data() + tx_tail_,
+                                                tx_backlog_.size() - tx_tail_, params);
+    if (!encoded.ok) {
+        throw std::invalid_argument("FramedLink framing parameters are invalid");
+    }
+    tx_tail_ += encoded.bytes_written;
+    return true;
+}
+
+FramedLink::ExchangeResult FramedLink::exchange(const FrameCallback& on_frame) {
+    ExchangeResult result;
+    const std::size_t length = options_.transfer_bytes;
+
+    result.frame_bytes_sent = std::min(pendingTxBytes(), length);
+    std::memcpy(tx_buffer_.data(), tx_backlog_.data() + tx_head_, result.frame_bytes_sent);
+    result.fill_bytes_sent = length - result.frame_bytes_sent;
+    std::memset(tx_buffer_.data() + result.frame_bytes_sent, options_.fill_byte, result.fill_bytes_sent);
+
+    transfer_(rx_buffer_.data(), tx_buffer_.data(), length);
+
+    // Only retire TX bytes once they have actually been clocked out.
+    tx_head_ += result.frame_bytes_sent;
+    if (tx_head_ == tx_tail_) {
+        tx_head_ = 0;
+        tx_tail_ = 0;
+    }
+
+    const auto summary = decoder_.decode(rx_buffer_.data(), length, rx_frame_,
+                                         [&](const FrameDecoder::Result& frame_result) {
+        if (on_frame) {
+            on_frame(frame_result, rx_frame_);
+        }
+    });
+    result.frames_received = summary.frames_ready;
+    result.frames_dropped = summary.frames_dropped;
+    return result;
+}
+
+} // namespace spi_eak
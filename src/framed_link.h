@@ -0,0 +1,86 @@
+#ifndef FRAMED_LINK_H
+#define FRAMED_LINK_H
+
+#include "link_layer.h"
+#include "spi.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace spi_eak {
+
+/**
+ * Full-duplex framed session over one SPI device.
+ *
+ * Outgoing payloads are encoded into a TX backlog; every exchange() clocks a
+ * fixed number of bytes, taking them from the backlog (frames may straddle
+ * exchanges) and padding idle time with fill_byte. The RX half of the same
+ * transfer is fed straight into a FrameDecoder, so the peer can stream
+ * frames back while we transmit.
+ */
+class FramedLink {
+public:
+    /**
+     * Performs one full-duplex transfer; lets the link run over something
+     * other than an SPI handle (tests, simulators, AsyncSPI wrappers).
+     */
+    using Transfer = std::function<void(uint8_t* rx, const uint8_t* tx, std::size_t length)>;
+
+    struct Options {
+        FrameDecoder::Options decoder;          // decoder.params is also used to encode
+        std::size_t transfer_bytes = 256;       // bytes clocked per exchange()
+        std::size_t tx_backlog_bytes = 16 * 1024;
+        uint8_t fill_byte = 0x00;               // idle filler; see FrameCodec::isIdleFill()
+    };
+
+    /**
+     * Called for every received frame or drop; `payload` is valid only for
+     * the duration of the call when result.frame_ready is set.
+     */
+    using FrameCallback = std::function<void(const FrameDecoder::Result& result,
+                                             const std::vector<uint8_t>& payload)>;
+
+    struct ExchangeResult {
+        std::size_t frame_bytes_sent = 0; // backlog bytes clocked out
+        std::size_t fill_bytes_sent = 0;
+        std::size_t frames_received = 0;
+        std::size_t frames_dropped = 0;
+    };
+
+    FramedLink(SPI& spi, const Options& options);
+    FramedLink(Transfer transfer, const Options& options);
+
+    /**
+     * Encode and queue a payload. Returns false when the backlog cannot hold
+     * the encoded frame; throws std::invalid_argument for invalid framing
+     * parameters.
+     */
+    bool send(const uint8_t* payload, std::size_t length);
+    bool send(const std::vector<uint8_t>& payload) { return send(payload.data(), payload.size()); }
+
+    /**
+     * Clock one transfer_bytes transfer: TX from the backlog, RX into the
+     * decoder. Transfer errors propagate as exceptions.
+     */
+    ExchangeResult exchange(const FrameCallback& on_frame);
+
+    [[nodiscard]] std::size_t pendingTxBytes() const noexcept { return tx_tail_ - tx_head_; }
+    [[nodiscard]] const Options& options() const noexcept { return options_; }
+
+private:
+    Options options_;
+    Transfer transfer_;
+    FrameDecoder decoder_;
+    std::vector<uint8_t> tx_backlog_;
+    std::size_t tx_head_ = 0;
+    std::size_t tx_tail_ = 0;
+    std::vector<uint8_t> tx_buffer_;
+    std::vector<uint8_t> rx_buffer_;
+    std::vector<uint8_t> rx_frame_;
+};
+
+} // namespace spi_eak
+
+#endif // FRAMED_LINK_H
@@ -0,0 +1,198 @@
+#include "gather_encoder.h"
+
+#include "byte_scan.h"
+#include "crc.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace spi_eak {
+
+namespace {
+
+constexpr std::size_t kNoSegment = std::numeric_limits<std::size_t>::max();
+
+} // namespace
+
+// Appends segments for one frame: references for in-place runs, and scratch
+// segments that grow while consecutive copies land contiguously.
+class GatherEncoder::Builder {
+public:
+    Builder(GatherEncoder& encoder, std::vector<SPI::Segment>& segments, uint8_t* rx, Result& result)
+        : encoder_(encoder)
+        , segments_(segments)
+        , rx_(rx)
+        , result_(result) {}
+
+    void reference(const uint8_t* data, std::size_t length) {
+        SPI::Segment segment;
+        segment.tx_buffer = data;
+        segment.rx_buffer = rx_ ? rx_ + offset_ : nullptr;
+        segment.length = length;
+        segments_.push_back(segment);
+        ++result_.segments;
+        result_.referenced_bytes += length;
+        offset_ += length;
+        open_ = kNoSegment;
+    }
+
+    void copy(const uint8_t* data, std::size_t length) {
+        while (length > 0) {
+            uint8_t* dest = nullptr;
+            const std::size_t taken = reserve(length, dest);
+            std::memcpy(dest, data, taken);
+            data += taken;
+            length -= taken;
+        }
+    }
+
+    void put(uint8_t byte) { copy(&byte, 1); }
+
+    void putEscaped(uint8_t byte, const FrameCodec::Parameters& params) {
+        if (byte == params.start_byte || byte == params.stop_byte || byte == params.escape_byte) {
+            const uint8_t pair[2] = {params.escape_byte, static_cast<uint8_t>(byte ^ 0x20)};
+            copy(pair, sizeof(pair));
+        } else {
+            put(byte);
+        }
+    }
+
+    [[nodiscard]] std::size_t offset() const noexcept { return offset_; }
+
+private:
+    // Hands out up to `wanted` contiguous scratch bytes and accounts for them
+    // in the open scratch segment, starting a new one after a reference or
+    // when the chunk runs out.
+    std::size_t reserve(std::size_t wanted, uint8_t*& dest) {
+        const std::size_t chunk_bytes = encoder_.options_.scratch_chunk_bytes;
+        if (encoder_.used_ == chunk_bytes) {
+            ++encoder_.chunk_;
+            encoder_.used_ = 0;
+            open_ = kNoSegment;
+        }
+        if (encoder_.chunk_ == encoder_.chunks_.size()) {
+            encoder_.chunks_.emplace_back(new uint8_t[chunk_bytes]);
+        }
+
+        const std::size_t taken = std::min(wanted, chunk_bytes - encoder_.used_);
+        dest = encoder_.chunks_[encoder_.chunk_].get() + encoder_.used_;
+        if (open_ != kNoSegment) {
+            segments_[open_].length += taken;
+        } else {
+            SPI::Segment segment;
+            segment.tx_buffer = dest;
+            segment.rx_buffer = rx_ ? rx_ + offset_ : nullptr;
+            segment.length = taken;
+            segments_.push_back(segment);
+            open_ = segments_.size() - 1;
+            ++result_.segments;
+        }
+        encoder_.used_ += taken;
+        offset_ += taken;
+        result_.copied_bytes += taken;
+        return taken;
+    }
+
+    GatherEncoder& encoder_;
+    std::vector<SPI::Segment>& segments_;
+    uint8_t* rx_;
+    Result& result_;
+    std::size_t offset_ = 0;
+    std::size_t open_ = kNoSegment;
+};
+
+GatherEncoder::GatherEncoder()
+    : GatherEncoder(Options{}) {}
+
+GatherEncoder::GatherEncoder(const Options& options)
+    : options_(options) {
+    const FrameCodec::Parameters& params = options_.params;
+    if (FrameCodec::encodedSize(nullptr, 0, params) == 0) {
+        throw std::invalid_argument("GatherEncoder framing parameters are invalid");
+    }
+    if (params.framing != FrameCodec::Framing::Slip || params.compression != FrameCodec::Compression::None) {
+        throw std::invalid_argument("GatherEncoder supports SLIP framing without compression only");
+    }
+    if (options_.scratch_chunk_bytes == 0) {
+        throw std::invalid_argument("GatherEncoder scratch_chunk_bytes must be non-zero");
+    }
+}
+
+GatherEncoder::Result GatherEncoder::encode(const Span* spans,
+                                            std::size_t count,
+                                            std::vector<SPI::Segment>& segments,
+                                            uint8_t* rx) {
+    if (!spans && count > 0) {
+        throw std::invalid_argument("GatherEncoder::encode needs a span array");
+    }
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        if (!spans[idx].data && spans[idx].length > 0) {
+            throw std::invalid_argument("GatherEncoder span has a length but no data");
+        }
+    }
+
+    const FrameCodec::Parameters& params = options_.params;
+    const bool crc32c = params.checksum == FrameCodec::Checksum::Crc32C;
+    uint16_t crc16 = crc::kCrc16Init;
+    uint32_t crc32 = crc::kCrc32cInit;
+
+    Result result;
+    Builder builder(*this, segments, rx, result);
+    builder.put(params.start_byte);
+
+    std::size_t payload_bytes = 0;
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        const uint8_t* data = spans[idx].data;
+        const std::size_t length = spans[idx].length;
+        payload_bytes += length;
+        if (params.enable_crc16 && length > 0) {
+            if (crc32c) {
+                crc32 = crc::crc32cUpdate(crc32, data, length);
+            } else {
+                crc16 = crc::crc16Update(crc16, data, length);
+            }
+        }
+
+        std::size_t pos = 0;
+        while (pos < length) {
+            const std::size_t run = detail::findAnyOf3(data + pos, length - pos, params.start_byte,
+                                                       params.stop_byte, params.escape_byte);
+            if (run > 0 && run >= options_.min_reference_bytes) {
+                builder.reference(data + pos, run);
+            } else if (run > 0) {
+                builder.copy(data + pos, run);
+            }
+            pos += run;
+            if (pos < length) {
+                builder.putEscaped(data[pos], params);
+                ++pos;
+            }
+        }
+    }
+
+    // Checksum trailer is big-endian regardless of width.
+    const uint32_t checksum = crc32c ? crc::crc32cFinalize(crc32) : crc16;
+    for (std::size_t idx = FrameCodec::checksumBytes(params); idx > 0; --idx) {
+        builder.putEscaped(static_cast<uint8_t>((checksum >> (8 * (idx - 1))) & 0xFF), params);
+    }
+    builder.put(params.stop_byte);
+    result.frame_bytes = builder.offset();
+
+    if (LinkMetrics* metrics = params.metrics) {
+        const std::size_t unescaped = payload_bytes + FrameCodec::checksumBytes(params) + 2;
+        detail::bump(metrics->frames_encoded);
+        detail::bump(metrics->payload_bytes_encoded, payload_bytes);
+        detail::bump(metrics->frame_bytes_encoded, result.frame_bytes);
+        detail::bump(metrics->escape_bytes_encoded, result.frame_bytes - unescaped);
+    }
+    return result;
+}
+
+void GatherEncoder::clear() noexcept {
+    chunk_ = 0;
+    used_ = 0;
+}
+
+} // namespace spi_eak
@@ -0,0 +1,103 @@
+#ifndef GATHER_ENCODER_H
+#define GATHER_ENCODER_H
+
+#include "link_layer.h"
+#include "spi.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+namespace spi_eak {
+
+/**
+ * Frames a payload given as several spans (header, body, trailer...)
+ * straight into an SPI::Segment list, without concatenating them first.
+ *
+ * The checksum is carried across the spans incrementally. Runs of payload
+ * bytes that need no escaping are referenced in place; only the start/stop
+ * bytes, escape pairs, checksum trailer and runs shorter than
+ * min_reference_bytes are written to internal scratch. Pass the segments
+ * to SPI::transfer(const std::vector<Segment>&) while the spans are alive
+ * and before the next clear().
+ *
+ * The wire format is identical to FrameCodec::encode() over the
+ * concatenated spans. Only SLIP framing without compression is supported.
+ * spidev still copies every segment into its kernel buffer, so one message
+ * must stay within SPI::messageLimit(). It must also stay within
+ * SPI::maxSegmentsPerMessage() segments, or transfer() throws. Every
+ * sentinel between two referenced runs costs a scratch segment, so an
+ * escape-dense payload can need up to about 2 * frame_bytes /
+ * min_reference_bytes segments. Check Result::segments, or raise
+ * min_reference_bytes, for large frames.
+ */
+class GatherEncoder {
+public:
+    struct Span {
+        const uint8_t* data = nullptr;
+        std::size_t length = 0;
+    };
+
+    struct Options {
+        FrameCodec::Parameters params;
+        std::size_t min_reference_bytes = 64;  // shorter clean runs are cheaper to copy than to add a segment
+        std::size_t scratch_chunk_bytes = 4096;
+    };
+
+    struct Result {
+        std::size_t frame_bytes = 0;      // encoded size, as FrameCodec::encodedSize() would report
+        std::size_t segments = 0;         // segments appended by this call
+        std::size_t referenced_bytes = 0; // payload bytes left in place
+        std::size_t copied_bytes = 0;     // bytes written to scratch
+    };
+
+    GatherEncoder();
+
+    /**
+     * Throws std::invalid_argument for invalid framing parameters, COBS
+     * framing or compression.
+     */
+    explicit GatherEncoder(const Options& options);
+
+    GatherEncoder(const GatherEncoder&) = delete;
+    GatherEncoder& operator=(const GatherEncoder&) = delete;
+
+    /**
+     * Append one frame over the concatenation of `spans` to `segments`.
+     * Several frames may be appended before the list is transferred. When
+     * `rx` is non-null each segment also receives into it at the segment's
+     * offset within this frame, so it must hold result.frame_bytes.
+     */
+    Result encode(const Span* spans,
+                  std::size_t count,
+                  std::vector<SPI::Segment>& segments,
+                  uint8_t* rx = nullptr);
+
+    Result encode(std::initializer_list<Span> spans,
+                  std::vector<SPI::Segment>& segments,
+                  uint8_t* rx = nullptr) {
+        return encode(spans.begin(), spans.size(), segments, rx);
+    }
+
+    /**
+     * Recycle the scratch space; segments produced so far become invalid.
+     * Scratch chunks are kept, so steady-state encoding does not allocate.
+     */
+    void clear() noexcept;
+
+    [[nodiscard]] const Options& options() const noexcept { return options_; }
+
+private:
+    class Builder;
+
+    Options options_;
+    std::vector<std::unique_ptr<uint8_t[]>> chunks_;
+    std::size_t chunk_ = 0; // chunk being filled
+    std::size_t used_ = 0;  // bytes used in chunks_[chunk_]
+};
+
+} // namespace spi_eak
+
+#endif // GATHER_ENCODER_H
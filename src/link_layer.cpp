@@ -1,92 +1,364 @@
 #include "link_layer.h"
 
-#include <array>
+#include "byte_scan.h"
+#include "compression.h"
+#include "crc.h"
+
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
 
 namespace spi_eak {
 
 namespace {
 
-constexpr uint16_t crc16_entry(uint8_t idx) {
-    uint16_t crc = static_cast<uint16_t>(idx) << 8;
-    for (int i = 0; i < 8; ++i) {
-        if (crc & 0x8000) {
-            crc = static_cast<uint16_t>((crc << 1) ^ 0x1021);
-        } else {
-            crc <<= 1;
-        }
+// Computes the trailer value; only the low checksumBytes() bytes are sent.
+uint32_t payloadChecksum(const uint8_t* payload,
+                         std::size_t length,
+                         const FrameCodec::Parameters& params) {
+    if (!params.enable_crc16) {
+        return 0;
     }
-    return crc;
+    if (params.checksum == FrameCodec::Checksum::Crc32C) {
+        return crc::crc32c(payload, length);
+    }
+    return crc::crc16_ccitt(payload, length);
 }
 
-constexpr std::array<uint16_t, 256> makeCrc16Table() {
-    std::array<uint16_t, 256> table{};
-    for (std::size_t idx = 0; idx < table.size(); ++idx) {
-        table[idx] = crc16_entry(static_cast<uint8_t>(idx));
+FrameCodec::EncodeError validateParameters(const FrameCodec::Parameters& params) {
+    if (params.framing == FrameCodec::Framing::Slip) {
+        if (params.start_byte == params.stop_byte) {
+            return FrameCodec::EncodeError::InvalidStartStop;
+        }
+        if (params.escape_byte == params.start_byte || params.escape_byte == params.stop_byte) {
+            return FrameCodec::EncodeError::InvalidEscape;
+        }
+    }
+    if (params.compression == FrameCodec::Compression::DeltaRle &&
+        (params.delta_stride == 0 || params.delta_stride > 8)) {
+        return FrameCodec::EncodeError::InvalidCompression;
     }
-    return table;
+    return FrameCodec::EncodeError::None;
 }
 
-constexpr auto kCrc16Table = makeCrc16Table();
+// Bytes that are checksummed and escaped: the payload itself, or a flag byte
+// plus the compressed (or stored) payload in per-thread scratch. The scratch
+// grows to the largest payload once, then encoding stays off the heap.
+struct WireBody {
+    const uint8_t* data;
+    std::size_t length;
+};
 
-uint16_t crc16_ccitt(const uint8_t* data, std::size_t length) {
-    uint16_t crc = 0xFFFF;
-    for (std::size_t idx = 0; idx < length; ++idx) {
-        uint8_t tbl_idx = static_cast<uint8_t>((crc >> 8) ^ data[idx]);
-        crc = static_cast<uint16_t>((crc << 8) ^ kCrc16Table[tbl_idx]);
+WireBody wireBody(const uint8_t* payload, std::size_t length, const FrameCodec::Parameters& params) {
+    if (params.compression == FrameCodec::Compression::None) {
+        return {payload, length};
+    }
+    thread_local std::vector<uint8_t> scratch;
+    if (scratch.size() < length + 1) {
+        scratch.resize(length + 1);
     }
-    return crc;
+    const compress::Method method = params.compression == FrameCodec::Compression::Lz
+                                        ? compress::Method::Lz
+                                        : compress::Method::DeltaRle;
+    const std::size_t written = compress::compressPayload(method, params.delta_stride, payload, length,
+                                                          scratch.data(), scratch.size());
+    return {scratch.data(), written};
 }
 
-uint16_t crc16_ccitt(const std::vector<uint8_t>& data) {
-    return crc16_ccitt(data.data(), data.size());
+bool needsEscape(uint8_t value, const FrameCodec::Parameters& params) {
+    return value == params.escape_byte || value == params.start_byte || value == params.stop_byte;
 }
 
-void appendEscaped(std::vector<uint8_t>& frame,
-                   uint8_t value,
-                   uint8_t escape_byte,
-                   uint8_t start_byte,
-                   uint8_t stop_byte) {
-    if (value == escape_byte || value == start_byte || value == stop_byte) {
-        frame.push_back(escape_byte);
-        frame.push_back(static_cast<uint8_t>(value ^ 0x20));
+uint8_t* writeEscaped(uint8_t* out, uint8_t value, const FrameCodec::Parameters& params) {
+    if (needsEscape(value, params)) {
+        *out++ = params.escape_byte;
+        *out++ = static_cast<uint8_t>(value ^ 0x20);
     } else {
-        frame.push_back(value);
+        *out++ = value;
+    }
+    return out;
+}
+
+// Copies clean runs with memcpy and only branches on bytes that need escaping.
+uint8_t* writeEscapedRun(uint8_t* out,
+                         const uint8_t* data,
+                         std::size_t length,
+                         const FrameCodec::Parameters& params) {
+    // Locals, so stores through `out` do not force the sentinels to reload.
+    const uint8_t start = params.start_byte;
+    const uint8_t stop = params.stop_byte;
+    const uint8_t escape = params.escape_byte;
+    std::size_t idx = 0;
+    while (idx < length) {
+        // Settle a sentinel directly rather than start a scan that would
+        // stop at offset 0.
+        const uint8_t byte = data[idx];
+        if (byte == start || byte == stop || byte == escape) {
+            *out++ = escape;
+            *out++ = static_cast<uint8_t>(byte ^ 0x20);
+            ++idx;
+            continue;
+        }
+        const std::size_t run = detail::findAnyOf3(data + idx, length - idx, start, stop, escape);
+        std::memcpy(out, data + idx, run);
+        out += run;
+        idx += run;
+    }
+    return out;
+}
+
+// COBS splits the data into blocks of up to 254 non-zero bytes, each led by
+// a code byte (block length + 1); a code below 0xFF implies a zero after its
+// block. The writer below emits exactly the blocks this counter predicts.
+class CobsCounter {
+public:
+    void put(const uint8_t* data, std::size_t length) {
+        bytes_ += length;
+        while (length > 0) {
+            const void* zero = std::memchr(data, 0, length);
+            if (!zero) {
+                run_ += length;
+                return;
+            }
+            const std::size_t run = static_cast<std::size_t>(static_cast<const uint8_t*>(zero) - data);
+            blocks_ += (run_ + run) / 254 + 1;
+            run_ = 0;
+            ++zeros_;
+            data += run + 1;
+            length -= run + 1;
+        }
+    }
+
+    std::size_t finish() const { return bytes_ - zeros_ + (run_ / 254 + 1) + blocks_; }
+
+private:
+    std::size_t bytes_ = 0;
+    std::size_t zeros_ = 0;
+    std::size_t blocks_ = 0;
+    std::size_t run_ = 0;
+};
+
+class CobsWriter {
+public:
+    explicit CobsWriter(uint8_t* out)
+        : code_(out)
+        , out_(out + 1) {}
+
+    void put(const uint8_t* data, std::size_t length) {
+        while (length > 0) {
+            if (*data == 0x00) {
+                finishBlock(); // zero-dense data: skip the scan
+                ++data;
+                --length;
+                continue;
+            }
+            const std::size_t chunk = std::min<std::size_t>(length, 0xFF - count_);
+            const void* zero = std::memchr(data, 0, chunk);
+            const std::size_t run =
+                zero ? static_cast<std::size_t>(static_cast<const uint8_t*>(zero) - data) : chunk;
+            std::memcpy(out_, data, run);
+            out_ += run;
+            count_ = static_cast<uint8_t>(count_ + run);
+            data += run;
+            length -= run;
+            if (zero) {
+                finishBlock();
+                ++data;
+                --length;
+            } else if (count_ == 0xFF) {
+                finishBlock(); // full block, no implied zero
+            }
+        }
+    }
+
+    uint8_t* finish() {
+        *code_ = count_;
+        return out_;
     }
+
+private:
+    void finishBlock() {
+        *code_ = count_;
+        code_ = out_++;
+        count_ = 1;
+    }
+
+    uint8_t* code_;
+    uint8_t* out_;
+    uint8_t count_ = 1;
+};
+
+std::size_t checksumTrailer(uint32_t crc, const FrameCodec::Parameters& params, uint8_t* out) {
+    // Checksum trailer is big-endian regardless of width.
+    const std::size_t bytes = FrameCodec::checksumBytes(params);
+    for (std::size_t idx = 0; idx < bytes; ++idx) {
+        out[idx] = static_cast<uint8_t>((crc >> (8 * (bytes - 1 - idx))) & 0xFF);
+    }
+    return bytes;
+}
+
+std::size_t frameSize(const uint8_t* payload,
+                      std::size_t length,
+                      uint32_t crc,
+                      const FrameCodec::Parameters& params) {
+    if (params.framing == FrameCodec::Framing::Cobs) {
+        CobsCounter counter;
+        uint8_t trailer[4];
+        if (length > 0) {
+            counter.put(payload, length);
+        }
+        counter.put(trailer, checksumTrailer(crc, params, trailer));
+        return 2 + counter.finish(); // leading and trailing delimiters
+    }
+
+    std::size_t size = 2 + length; // start + stop + payload
+    if (length > 0) {
+        size += detail::countAnyOf3(payload, length, params.start_byte, params.stop_byte,
+                                    params.escape_byte);
+    }
+    for (std::size_t idx = FrameCodec::checksumBytes(params); idx > 0; --idx) {
+        const uint8_t value = static_cast<uint8_t>((crc >> (8 * (idx - 1))) & 0xFF);
+        size += needsEscape(value, params) ? 2 : 1;
+    }
+    return size;
+}
+
+// Caller guarantees `out` holds at least frameSize() bytes.
+std::size_t writeFrame(uint8_t* out,
+                       const uint8_t* payload,
+                       std::size_t length,
+                       uint32_t crc,
+                       const FrameCodec::Parameters& params) {
+    if (params.framing == FrameCodec::Framing::Cobs) {
+        uint8_t trailer[4];
+        out[0] = 0x00;
+        CobsWriter writer(out + 1);
+        if (length > 0) {
+            writer.put(payload, length);
+        }
+        writer.put(trailer, checksumTrailer(crc, params, trailer));
+        uint8_t* cursor = writer.finish();
+        *cursor++ = 0x00;
+        return static_cast<std::size_t>(cursor - out);
+    }
+
+    uint8_t* cursor = out;
+    *cursor++ = params.start_byte;
+    if (length > 0) {
+        cursor = writeEscapedRun(cursor, payload, length, params);
+    }
+    // Checksum trailer is big-endian regardless of width.
+    for (std::size_t idx = FrameCodec::checksumBytes(params); idx > 0; --idx) {
+        cursor = writeEscaped(cursor, static_cast<uint8_t>((crc >> (8 * (idx - 1))) & 0xFF), params);
+    }
+    *cursor++ = params.stop_byte;
+    return static_cast<std::size_t>(cursor - out);
 }
+
+void recordEncode(const FrameCodec::Parameters& params,
+                  std::size_t payload_bytes,
+                  std::size_t body_bytes,
+                  std::size_t frame_bytes) {
+    LinkMetrics* metrics = params.metrics;
+    if (!metrics) {
+        return;
+    }
+    const std::size_t unescaped = body_bytes + FrameCodec::checksumBytes(params) + 2;
+    detail::bump(metrics->frames_encoded);
+    detail::bump(metrics->payload_bytes_encoded, payload_bytes);
+    detail::bump(metrics->frame_bytes_encoded, frame_bytes);
+    detail::bump(metrics->escape_bytes_encoded, frame_bytes - unescaped);
+}
+
+static_assert(static_cast<std::size_t>(FrameDecoder::Result::DropReason::Malformed) <
+                  LinkMetrics::kDropReasons,
+              "LinkMetrics::drops must have a slot for every DropReason");
 }
 
 FrameCodec::Result FrameCodec::encode(const std::vector<uint8_t>& payload,
                                       const Parameters& params) {
     Result result;
-    if (params.start_byte == params.stop_byte) {
+    const EncodeError error = validateParameters(params);
+    if (error != EncodeError::None) {
+        result.ok = false;
+        result.error = error;
+        return result;
+    }
+
+    // Size exactly once so escape-heavy payloads never reallocate mid-encode.
+    const WireBody body = wireBody(payload.data(), payload.size(), params);
+    const uint32_t crc = payloadChecksum(body.data, body.length, params);
+    result.frame.resize(frameSize(body.data, body.length, crc, params));
+    writeFrame(result.frame.data(), body.data, body.length, crc, params);
+    recordEncode(params, payload.size(), body.length, result.frame.size());
+    return result;
+}
+
+std::size_t FrameCodec::encodedSize(const uint8_t* payload,
+                                    std::size_t length,
+                                    const Parameters& params) {
+    if (validateParameters(params) != EncodeError::None || (!payload && length > 0)) {
+        return 0;
+    }
+    const WireBody body = wireBody(payload, length, params);
+    return frameSize(body.data, body.length, payloadChecksum(body.data, body.length, params), params);
+}
+
+FrameCodec::EncodeIntoResult FrameCodec::encodeInto(const uint8_t* payload,
+                                                    std::size_t length,
+                                                    uint8_t* out,
+                                                    std::size_t capacity,
+                                                    const Parameters& params) {
+    EncodeIntoResult result;
+    const EncodeError error = validateParameters(params);
+    if (error != EncodeError::None) {
         result.ok = false;
-        result.error = EncodeError::InvalidStartStop;
+        result.error = error;
         return result;
     }
-    if (params.escape_byte == params.start_byte || params.escape_byte == params.stop_byte) {
+    if (!out || (!payload && length > 0)) {
         result.ok = false;
-        result.error = EncodeError::InvalidEscape;
+        result.error = EncodeError::BufferTooSmall;
         return result;
     }
 
-    result.frame.clear();
-    result.frame.reserve(payload.size() + 6); // rough guess for escapes + crc
-    result.frame.push_back(params.start_byte);
-
-    for (uint8_t byte : payload) {
-        appendEscaped(result.frame, byte, params.escape_byte, params.start_byte, params.stop_byte);
+    const WireBody body = wireBody(payload, length, params);
+    const uint32_t crc = payloadChecksum(body.data, body.length, params);
+    if (capacity < maxEncodedSize(length, params) &&
+        capacity < frameSize(body.data, body.length, crc, params)) {
+        result.ok = false;
+        result.error = EncodeError::BufferTooSmall;
+        return result;
     }
 
-    if (params.enable_crc16) {
-        uint16_t crc = crc16_ccitt(payload);
-        appendEscaped(result.frame, static_cast<uint8_t>((crc >> 8) & 0xFF),
-                      params.escape_byte, params.start_byte, params.stop_byte);
-        appendEscaped(result.frame, static_cast<uint8_t>(crc & 0xFF),
-                      params.escape_byte, params.start_byte, params.stop_byte);
+    result.bytes_written = writeFrame(out, body.data, body.length, crc, params);
+    recordEncode(params, length, body.length, result.bytes_written);
+    return result;
+}
+
+FrameCodec::EncodeIntoResult FrameCodec::encodeSized(const uint8_t* payload,
+                                                     std::size_t length,
+                                                     const Parameters& params,
+                                                     void* target,
+                                                     FrameSink sink) {
+    EncodeIntoResult result;
+    const EncodeError error = validateParameters(params);
+    if (error != EncodeError::None) {
+        result.ok = false;
+        result.error = error;
+        return result;
+    }
+    if (!payload && length > 0) {
+        result.ok = false;
+        result.error = EncodeError::BufferTooSmall;
+        return result;
     }
 
-    result.frame.push_back(params.stop_byte);
+    const WireBody body = wireBody(payload, length, params);
+    const uint32_t crc = payloadChecksum(body.data, body.length, params);
+    uint8_t* out = sink(target, frameSize(body.data, body.length, crc, params));
+    result.bytes_written = writeFrame(out, body.data, body.length, crc, params);
+    recordEncode(params, length, body.length, result.bytes_written);
     return result;
 }
 
@@ -104,15 +376,75 @@ FrameDecoder::FrameDecoder(const Options& options)
         throw std::invalid_argument("FrameDecoder max_frame_bytes must be non-zero");
     }
     buffer_.reserve(options_.max_frame_bytes);
+    if (options_.params.compression != FrameCodec::Compression::None) {
+        inflate_.resize(options_.max_frame_bytes);
+    }
+}
+
+FrameDecoder::FrameDecoder(const Options& options, FramePool& pool)
+    : options_(options)
+    , pool_(&pool) {
+    if (options_.max_frame_bytes == 0) {
+        throw std::invalid_argument("FrameDecoder max_frame_bytes must be non-zero");
+    }
+    if (pool.bufferBytes() < options_.max_frame_bytes) {
+        throw std::invalid_argument("FramePool buffers are smaller than max_frame_bytes");
+    }
+    if (options_.params.compression != FrameCodec::Compression::None) {
+        inflate_.resize(options_.max_frame_bytes);
+    }
 }
 
 FrameDecoder::Result FrameDecoder::push(uint8_t byte, std::vector<uint8_t>& out_frame) {
+    return step(byte, out_frame);
+}
+
+FrameDecoder::Result FrameDecoder::push(uint8_t byte, FramePool::Buffer& out_frame) {
+    if (!pool_) {
+        throw std::logic_error("FrameDecoder was constructed without a FramePool");
+    }
+    return step(byte, out_frame);
+}
+
+FrameDecoder::Result FrameDecoder::push(uint8_t byte, ArenaVector& out_frame) {
+    return step(byte, out_frame);
+}
+
+FrameDecoder::DecodeSummary FrameDecoder::decode(const uint8_t* data,
+                                                 std::size_t length,
+                                                 std::vector<uint8_t>& out_frame,
+                                                 const ResultCallback& on_result) {
+    return decodeBuffer(data, length, out_frame, on_result);
+}
+
+FrameDecoder::DecodeSummary FrameDecoder::decode(const uint8_t* data,
+                                                 std::size_t length,
+                                                 FramePool::Buffer& out_frame,
+                                                 const ResultCallback& on_result) {
+    if (!pool_) {
+        throw std::logic_error("FrameDecoder was constructed without a FramePool");
+    }
+    return decodeBuffer(data, length, out_frame, on_result);
+}
+
+FrameDecoder::DecodeSummary FrameDecoder::decode(const uint8_t* data,
+                                                 std::size_t length,
+                                                 ArenaVector& out_frame,
+                                                 const ResultCallback& on_result) {
+    return decodeBuffer(data, length, out_frame, on_result);
+}
+
+template <typename Frame>
+FrameDecoder::Result FrameDecoder::step(uint8_t byte, Frame& out_frame) {
+    if (options_.params.framing == FrameCodec::Framing::Cobs) {
+        return stepCobs(byte, out_frame);
+    }
     Result result;
 
     if (byte == options_.params.start_byte) {
-        buffer_.clear();
-        in_frame_ = true;
-        escape_next_ = false;
+        if (!beginFrame()) {
+            return drop(Result::DropReason::PoolExhausted);
+        }
         return result;
     }
 
@@ -121,75 +453,356 @@ FrameDecoder::Result FrameDecoder::push(uint8_t byte, std::vector<uint8_t>& out_
     }
 
     if (byte == options_.params.stop_byte) {
-        if (options_.params.enable_crc16) {
-            if (buffer_.size() < 2) {
-                reset();
-                if (options_.max_frame_bytes) {
-                    buffer_.reserve(options_.max_frame_bytes);
-                }
-                result.frame_dropped = true;
-                result.drop_reason = Result::DropReason::TooShortForCrc;
-                return result;
-            }
-            const size_t payload_size = buffer_.size() - 2;
-            uint16_t received_crc = static_cast<uint16_t>(buffer_[payload_size]) << 8;
-            received_crc |= buffer_[payload_size + 1];
-            if (crc16_ccitt(buffer_.data(), payload_size) != received_crc) {
-                reset();
-                if (options_.max_frame_bytes) {
-                    buffer_.reserve(options_.max_frame_bytes);
-                }
-                result.frame_dropped = true;
-                result.drop_reason = Result::DropReason::CrcMismatch;
-                return result;
-            }
-            buffer_.resize(payload_size);
+        return completeFrame(out_frame);
+    }
+
+    if (escape_next_) {
+        if (frameSize() >= options_.max_frame_bytes) {
+            return drop(Result::DropReason::FrameTooLarge);
         }
+        appendByte(static_cast<uint8_t>(byte ^ 0x20));
+        escape_next_ = false;
+        return result;
+    }
 
-        out_frame = buffer_;
-        reset();
-        result.frame_ready = true;
+    if (byte == options_.params.escape_byte) {
+        escape_next_ = true;
         return result;
     }
 
-    if (escape_next_) {
-        if (options_.max_frame_bytes && buffer_.size() >= options_.max_frame_bytes) {
-            reset();
-            if (options_.max_frame_bytes) {
-                buffer_.reserve(options_.max_frame_bytes);
+    if (frameSize() >= options_.max_frame_bytes) {
+        return drop(Result::DropReason::FrameTooLarge);
+    }
+    appendByte(byte);
+    return result;
+}
+
+template <typename Frame>
+FrameDecoder::Result FrameDecoder::completeFrame(Frame& out_frame) {
+    Result result;
+    const std::size_t crc_bytes = FrameCodec::checksumBytes(options_.params);
+    if (crc_bytes > 0) {
+        const std::size_t frame_size = frameSize();
+        if (frame_size < crc_bytes) {
+            return drop(Result::DropReason::TooShortForCrc);
+        }
+        const size_t payload_size = frame_size - crc_bytes;
+        const uint8_t* frame = frameData();
+        uint32_t received_crc = 0;
+        for (std::size_t idx = 0; idx < crc_bytes; ++idx) {
+            received_crc = (received_crc << 8) | frame[payload_size + idx];
+        }
+        if (payloadChecksum(frame, payload_size, options_.params) != received_crc) {
+            return drop(Result::DropReason::CrcMismatch);
+        }
+        setFrameSize(payload_size);
+    }
+    if (options_.params.compression != FrameCodec::Compression::None) {
+        const Result::DropReason reason = inflate();
+        if (reason != Result::DropReason::None) {
+            return drop(reason);
+        }
+    }
+
+    if (options_.params.metrics) {
+        detail::bump(options_.params.metrics->frames_decoded);
+        detail::bump(options_.params.metrics->payload_bytes_decoded, frameSize());
+    }
+    deliver(out_frame);
+    reset();
+    result.frame_ready = true;
+    return result;
+}
+
+template <typename Frame>
+FrameDecoder::Result FrameDecoder::stepCobs(uint8_t byte, Frame& out_frame) {
+    Result result;
+
+    if (byte == 0x00) {
+        // A delimiter both ends the current frame and starts the next.
+        if (in_frame_) {
+            const bool empty = frameSize() == 0 && cobs_left_ == 0 && !cobs_zero_pending_;
+            if (empty) {
+                return result; // idle fill or back-to-back delimiters
             }
-            result.frame_dropped = true;
-            result.drop_reason = Result::DropReason::FrameTooLarge;
-            escape_next_ = false;
+            result = cobs_left_ > 0 ? drop(Result::DropReason::Malformed) : completeFrame(out_frame);
+            beginFrame(); // on pool exhaustion we resync at the next delimiter
             return result;
         }
-        buffer_.push_back(static_cast<uint8_t>(byte ^ 0x20));
-        escape_next_ = false;
+        if (!beginFrame()) {
+            return drop(Result::DropReason::PoolExhausted);
+        }
         return result;
     }
 
-    if (byte == options_.params.escape_byte) {
-        escape_next_ = true;
+    if (!in_frame_) {
         return result;
     }
 
-    if (options_.max_frame_bytes && buffer_.size() >= options_.max_frame_bytes) {
-        reset();
-        if (options_.max_frame_bytes) {
-            buffer_.reserve(options_.max_frame_bytes);
+    if (cobs_left_ == 0) {
+        // Code byte: the previous block's implied zero becomes data now that
+        // another block follows.
+        if (cobs_zero_pending_) {
+            if (frameSize() >= options_.max_frame_bytes) {
+                return drop(Result::DropReason::FrameTooLarge);
+            }
+            appendByte(0x00);
         }
-        result.frame_dropped = true;
-        result.drop_reason = Result::DropReason::FrameTooLarge;
+        cobs_left_ = static_cast<std::size_t>(byte) - 1;
+        cobs_zero_pending_ = byte != 0xFF;
         return result;
     }
-    buffer_.push_back(byte);
+
+    if (frameSize() >= options_.max_frame_bytes) {
+        return drop(Result::DropReason::FrameTooLarge);
+    }
+    appendByte(byte);
+    --cobs_left_;
     return result;
 }
 
+template <typename Frame>
+FrameDecoder::DecodeSummary FrameDecoder::decodeBuffer(const uint8_t* data,
+                                                       std::size_t length,
+                                                       Frame& out_frame,
+                                                       const ResultCallback& on_result) {
+    if (options_.params.framing == FrameCodec::Framing::Cobs) {
+        return decodeCobs(data, length, out_frame, on_result);
+    }
+    DecodeSummary summary;
+    if (!data) {
+        return summary;
+    }
+
+    const uint8_t start = options_.params.start_byte;
+    const uint8_t stop = options_.params.stop_byte;
+    const uint8_t escape = options_.params.escape_byte;
+
+    auto report = [&](const Result& result) {
+        if (result.frame_ready) {
+            ++summary.frames_ready;
+        }
+        if (result.frame_dropped) {
+            ++summary.frames_dropped;
+        }
+        if ((result.frame_ready || result.frame_dropped) && on_result) {
+            on_result(result);
+        }
+    };
+
+    std::size_t idx = 0;
+    while (idx < length) {
+        if (!in_frame_) {
+            // Outside a frame only the start byte matters.
+            const void* hit = std::memchr(data + idx, start, length - idx);
+            if (!hit) {
+                break;
+            }
+            idx = static_cast<std::size_t>(static_cast<const uint8_t*>(hit) - data);
+        } else if (!escape_next_) {
+            const uint8_t byte = data[idx];
+            if (byte == escape) {
+                // Unescape a complete pair in place; a pair split across
+                // calls, or one that ends the frame early, takes step().
+                if (idx + 1 < length && data[idx + 1] != start && data[idx + 1] != stop &&
+                    frameSize() < options_.max_frame_bytes) {
+                    appendByte(static_cast<uint8_t>(data[idx + 1] ^ 0x20));
+                    idx += 2;
+                    continue;
+                }
+            } else if (byte != start && byte != stop) {
+                // Only a plain byte can begin a run, so the scan never
+                // comes back empty.
+                const std::size_t run = detail::findAnyOf3(data + idx, length - idx, start, stop, escape);
+                const std::size_t room = options_.max_frame_bytes - frameSize();
+                if (run > room) {
+                    // push() would accept `room` bytes and drop on the next one.
+                    report(drop(Result::DropReason::FrameTooLarge));
+                    idx += room + 1;
+                    continue;
+                }
+                appendRun(data + idx, run);
+                idx += run;
+                continue;
+            }
+        }
+
+        // Sentinels and escaped bytes go through the byte-wise state machine.
+        report(step(data[idx], out_frame));
+        ++idx;
+    }
+
+    return summary;
+}
+
+template <typename Frame>
+FrameDecoder::DecodeSummary FrameDecoder::decodeCobs(const uint8_t* data,
+                                                     std::size_t length,
+                                                     Frame& out_frame,
+                                                     const ResultCallback& on_result) {
+    DecodeSummary summary;
+    if (!data) {
+        return summary;
+    }
+
+    auto report = [&](const Result& result) {
+        if (result.frame_ready) {
+            ++summary.frames_ready;
+        }
+        if (result.frame_dropped) {
+            ++summary.frames_dropped;
+        }
+        if ((result.frame_ready || result.frame_dropped) && on_result) {
+            on_result(result);
+        }
+    };
+
+    std::size_t idx = 0;
+    while (idx < length) {
+        if (!in_frame_) {
+            // Unsynchronized: only a delimiter matters.
+            const void* hit = std::memchr(data + idx, 0x00, length - idx);
+            if (!hit) {
+                break;
+            }
+            idx = static_cast<std::size_t>(static_cast<const uint8_t*>(hit) - data);
+        } else if (cobs_left_ > 0 && data[idx] != 0x00) {
+            // Copy the rest of the block at once, stopping early at a delimiter.
+            const std::size_t available = std::min(cobs_left_, length - idx);
+            const void* zero = std::memchr(data + idx, 0x00, available);
+            const std::size_t run =
+                zero ? static_cast<std::size_t>(static_cast<const uint8_t*>(zero) - (data + idx)) : available;
+            const std::size_t room = options_.max_frame_bytes - frameSize();
+            if (run > room) {
+                // push() would accept `room` bytes and drop on the next one.
+                report(drop(Result::DropReason::FrameTooLarge));
+                idx += room + 1;
+                continue;
+            }
+            appendRun(data + idx, run);
+            cobs_left_ -= run;
+            idx += run;
+            continue;
+        }
+
+        report(stepCobs(data[idx], out_frame));
+        ++idx;
+    }
+
+    return summary;
+}
+
+FrameDecoder::Result FrameDecoder::drop(Result::DropReason reason) {
+    reset();
+    if (options_.params.metrics) {
+        detail::bump(options_.params.metrics->drops[static_cast<std::size_t>(reason)]);
+    }
+    Result result;
+    result.frame_dropped = true;
+    result.drop_reason = reason;
+    return result;
+}
+
+bool FrameDecoder::beginFrame() {
+    in_frame_ = true;
+    escape_next_ = false;
+    cobs_left_ = 0;
+    cobs_zero_pending_ = false;
+    if (!pool_) {
+        buffer_.clear();
+        return true;
+    }
+    if (!lease_) {
+        lease_ = pool_->acquire();
+        if (!lease_) {
+            in_frame_ = false;
+            return false;
+        }
+    }
+    lease_.resize(0);
+    return true;
+}
+
+FrameDecoder::Result::DropReason FrameDecoder::inflate() {
+    uint8_t* frame = pool_ ? lease_.data() : buffer_.data();
+    const std::size_t size = frameSize();
+    if (size > 0 && frame[0] == static_cast<uint8_t>(compress::Method::Stored)) {
+        std::memmove(frame, frame + 1, size - 1);
+        setFrameSize(size - 1);
+        return Result::DropReason::None;
+    }
+
+    const compress::Inflated inflated =
+        compress::decompressPayload(frame, size, inflate_.data(), options_.max_frame_bytes);
+    if (inflated.status == compress::Status::TooLarge) {
+        return Result::DropReason::FrameTooLarge;
+    }
+    if (inflated.status != compress::Status::Ok) {
+        return Result::DropReason::DecompressFailed;
+    }
+    // Both targets hold max_frame_bytes, so this never reallocates.
+    setFrameSize(0);
+    appendRun(inflate_.data(), inflated.bytes);
+    return Result::DropReason::None;
+}
+
+void FrameDecoder::deliver(std::vector<uint8_t>& out_frame) {
+    if (pool_) {
+        out_frame.assign(lease_.begin(), lease_.end());
+        return;
+    }
+    // Hand over our buffer and keep the caller's; its capacity is reused for
+    // the next frame, so a caller that reserved max_frame_bytes never allocates.
+    out_frame.swap(buffer_);
+    buffer_.clear();
+    buffer_.reserve(options_.max_frame_bytes);
+}
+
+void FrameDecoder::deliver(FramePool::Buffer& out_frame) {
+    out_frame = std::move(lease_);
+}
+
+void FrameDecoder::deliver(ArenaVector& out_frame) {
+    out_frame.assign(frameData(), frameData() + frameSize());
+}
+
+void FrameDecoder::setFrameSize(std::size_t size) {
+    if (pool_) {
+        lease_.resize(size);
+    } else {
+        buffer_.resize(size);
+    }
+}
+
+void FrameDecoder::appendByte(uint8_t byte) {
+    if (pool_) {
+        const std::size_t size = lease_.size();
+        lease_.data()[size] = byte;
+        lease_.resize(size + 1);
+    } else {
+        buffer_.push_back(byte);
+    }
+}
+
+void FrameDecoder::appendRun(const uint8_t* data, std::size_t length) {
+    if (pool_) {
+        const std::size_t size = lease_.size();
+        std::memcpy(lease_.data() + size, data, length);
+        lease_.resize(size + length);
+    } else {
+        buffer_.insert(buffer_.end(), data, data + length);
+    }
+}
+
 void FrameDecoder::reset() {
     in_frame_ = false;
     escape_next_ = false;
+    cobs_left_ = 0;
+    cobs_zero_pending_ = false;
     buffer_.clear();
+    if (lease_) {
+        lease_.resize(0);
+    }
 }
 
 } // namespace spi_eak
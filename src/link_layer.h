@@ -3,23 +3,79 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <vector>
 
+#include "frame_arena.h"
+#include "frame_pool.h"
+#include "metrics.h"
+
 namespace spi_eak {
 
 class FrameCodec {
 public:
+    enum class Checksum : uint8_t {
+        Crc16,  // CRC-16/CCITT-FALSE, 2-byte trailer
+        Crc32C  // CRC-32C (Castagnoli), 4-byte trailer for long frames
+    };
+
+    enum class Framing : uint8_t {
+        Slip, // start/stop sentinels plus escaping; escaped bytes double in size
+        Cobs  // consistent overhead byte stuffing between 0x00 delimiters; +1 byte per 254
+    };
+
+    enum class Compression : uint8_t {
+        None,     // payload goes out as-is, no flag byte
+        Lz,       // fast byte-oriented LZ77 for repetitive payloads
+        DeltaRle  // delta + run-length for arrays of delta_stride-byte samples
+    };
+
     struct Parameters {
+        Framing framing = Framing::Slip; // the sentinel bytes below only apply to Slip
         uint8_t start_byte = 0x7E;
         uint8_t stop_byte = 0x7F;
         uint8_t escape_byte = 0x7D;
-        bool enable_crc16 = true;
+        bool enable_crc16 = true; // gates the checksum trailer selected below
+        Checksum checksum = Checksum::Crc16;
+        // With compression enabled every frame carries a leading flag byte
+        // naming the method actually used, so payloads that do not shrink go
+        // out stored and a decoder accepts any method.
+        Compression compression = Compression::None;
+        uint8_t delta_stride = 1; // element width in bytes for DeltaRle (1-8)
+        LinkMetrics* metrics = nullptr; // optional counters; must outlive users of these params
     };
 
+    /**
+     * Size of the checksum trailer before escaping (0 when disabled).
+     */
+    static constexpr std::size_t checksumBytes(const Parameters& params) {
+        if (!params.enable_crc16) {
+            return 0;
+        }
+        return params.checksum == Checksum::Crc32C ? 4 : 2;
+    }
+
+    /**
+     * Whether `byte` can pad the gaps between frames without being read as
+     * frame data: anything but the start byte for Slip, 0x00 for Cobs.
+     */
+    static constexpr bool isIdleFill(uint8_t byte, const Parameters& params) {
+        return params.framing == Framing::Cobs ? byte == 0x00 : byte != params.start_byte;
+    }
+
+    /**
+     * Size of the compression flag byte (0 when compression is off).
+     */
+    static constexpr std::size_t compressionBytes(const Parameters& params) {
+        return params.compression == Compression::None ? 0 : 1;
+    }
+
     enum class EncodeError {
         None,
         InvalidStartStop,
-        InvalidEscape
+        InvalidEscape,
+        BufferTooSmall,
+        InvalidCompression
     };
 
     struct Result {
@@ -34,24 +90,109 @@ public:
     static Result encode(const std::vector<uint8_t>& payload) {
         return encode(payload, Parameters{});
     }
+
+    struct EncodeIntoResult {
+        bool ok = true;
+        EncodeError error = EncodeError::None;
+        std::size_t bytes_written = 0;
+    };
+
+    /**
+     * Encode into a caller-provided buffer without touching the heap.
+     * When capacity covers maxEncodedSize() the frame is written in a single
+     * pass; otherwise the exact size is computed first and BufferTooSmall is
+     * reported (with nothing written) if it does not fit.
+     */
+    static EncodeIntoResult encodeInto(const uint8_t* payload,
+                                       std::size_t length,
+                                       uint8_t* out,
+                                       std::size_t capacity,
+                                       const Parameters& params);
+
+    /**
+     * Encode into `frame`, reusing its storage. The frame is sized exactly
+     * (one checksum and escape count, as in encode()), so an ArenaVector
+     * draws a block for the real frame size rather than the worst case, and
+     * its bytes are not value-initialised first. `frame` ends up holding the
+     * bytes written; it is emptied on failure.
+     */
+    template <typename Allocator>
+    static EncodeIntoResult encode(const uint8_t* payload,
+                                   std::size_t length,
+                                   std::vector<uint8_t, Allocator>& frame,
+                                   const Parameters& params) {
+        const EncodeIntoResult result =
+            encodeSized(payload, length, params, &frame, [](void* target, std::size_t size) {
+                auto& vector = *static_cast<std::vector<uint8_t, Allocator>*>(target);
+                vector.resize(size);
+                return vector.data();
+            });
+        if (!result.ok) {
+            frame.clear();
+        }
+        return result;
+    }
+
+    /**
+     * Exact number of bytes encodeInto() will write for this payload.
+     * Returns 0 when the parameters are invalid.
+     */
+    static std::size_t encodedSize(const uint8_t* payload,
+                                   std::size_t length,
+                                   const Parameters& params);
+
+    /**
+     * Worst-case frame size (every payload, flag and CRC byte escaped, or
+     * one COBS code byte per 254); cheap enough to size stack or pooled
+     * buffers up front.
+     */
+    static constexpr std::size_t maxEncodedSize(std::size_t payload_length,
+                                                const Parameters& params) {
+        const std::size_t body = payload_length + compressionBytes(params) + checksumBytes(params);
+        if (params.framing == Framing::Cobs) {
+            return 2 + body + body / 254 + 1;
+        }
+        return 2 + 2 * body;
+    }
+
+private:
+    // Receives the exact frame size and returns storage for that many bytes.
+    using FrameSink = uint8_t* (*)(void* target, std::size_t size);
+
+    static EncodeIntoResult encodeSized(const uint8_t* payload,
+                                        std::size_t length,
+                                        const Parameters& params,
+                                        void* target,
+                                        FrameSink sink);
 };
 
 class FrameDecoder {
 public:
     struct Options {
         FrameCodec::Parameters params;
-        std::size_t max_frame_bytes = 2048;
+        std::size_t max_frame_bytes = 2048; // bounds both the wire frame and a decompressed payload
     };
 
     FrameDecoder();
     explicit FrameDecoder(const Options& options);
 
+    /**
+     * Pooled delivery mode: frames are assembled directly in buffers leased
+     * from `pool` and handed out by push()/decode() overloads taking a
+     * FramePool::Buffer, with no copy. Every pool buffer must hold at least
+     * max_frame_bytes. The pool must outlive the decoder.
+     */
+    FrameDecoder(const Options& options, FramePool& pool);
+
     struct Result {
         enum class DropReason {
             None,
             TooShortForCrc,
             CrcMismatch,
-            FrameTooLarge
+            FrameTooLarge,
+            PoolExhausted,
+            DecompressFailed,
+            Malformed // a COBS block ran past its frame's delimiter
         };
 
         bool frame_ready = false;
@@ -62,16 +203,96 @@ public:
     /**
      * Push a single byte from the SPI stream into the decoder.
      * Returns Result indicating whether a frame completed or was dropped.
+     * A completed payload is swapped into out_frame (copied in pooled mode).
      */
     Result push(uint8_t byte, std::vector<uint8_t>& out_frame);
 
+    /**
+     * Pooled-mode push: a completed frame's lease is moved into out_frame,
+     * releasing whatever out_frame held before. Throws std::logic_error when
+     * the decoder was built without a pool.
+     */
+    Result push(uint8_t byte, FramePool::Buffer& out_frame);
+
+    /**
+     * Arena push: a completed payload is copied into out_frame, which never
+     * reallocates once it has max_frame_bytes reserved.
+     */
+    Result push(uint8_t byte, ArenaVector& out_frame);
+
+    struct DecodeSummary {
+        std::size_t frames_ready = 0;
+        std::size_t frames_dropped = 0;
+    };
+
+    using ResultCallback = std::function<void(const Result&)>;
+
+    /**
+     * Decode a whole RX buffer in one call.
+     * Runs of ordinary bytes are located with a vectorized sentinel scan and
+     * copied in bulk; start/stop/escape bytes take the same path as push(), so
+     * the outcome is identical to pushing every byte individually. COBS
+     * frames are copied a whole block at a time.
+     * on_result is invoked for every completed or dropped frame, in stream
+     * order; when result.frame_ready is set, out_frame holds the payload.
+     */
+    DecodeSummary decode(const uint8_t* data,
+                         std::size_t length,
+                         std::vector<uint8_t>& out_frame,
+                         const ResultCallback& on_result);
+
+    DecodeSummary decode(const uint8_t* data,
+                         std::size_t length,
+                         FramePool::Buffer& out_frame,
+                         const ResultCallback& on_result);
+
+    DecodeSummary decode(const uint8_t* data,
+                         std::size_t length,
+                         ArenaVector& out_frame,
+                         const ResultCallback& on_result);
+
     void reset();
 
 private:
+    template <typename Frame>
+    Result step(uint8_t byte, Frame& out_frame);
+    template <typename Frame>
+    Result stepCobs(uint8_t byte, Frame& out_frame);
+    template <typename Frame>
+    Result completeFrame(Frame& out_frame);
+    template <typename Frame>
+    DecodeSummary decodeBuffer(const uint8_t* data,
+                               std::size_t length,
+                               Frame& out_frame,
+                               const ResultCallback& on_result);
+    template <typename Frame>
+    DecodeSummary decodeCobs(const uint8_t* data,
+                             std::size_t length,
+                             Frame& out_frame,
+                             const ResultCallback& on_result);
+
+    bool beginFrame();
+    Result::DropReason inflate();
+    Result drop(Result::DropReason reason);
+    void deliver(std::vector<uint8_t>& out_frame);
+    void deliver(FramePool::Buffer& out_frame);
+    void deliver(ArenaVector& out_frame);
+
+    std::size_t frameSize() const { return pool_ ? lease_.size() : buffer_.size(); }
+    const uint8_t* frameData() const { return pool_ ? lease_.data() : buffer_.data(); }
+    void setFrameSize(std::size_t size);
+    void appendByte(uint8_t byte);
+    void appendRun(const uint8_t* data, std::size_t length);
+
     Options options_;
     bool in_frame_ = false;
     bool escape_next_ = false;
+    std::size_t cobs_left_ = 0;      // data bytes remaining in the current COBS block
+    bool cobs_zero_pending_ = false; // the current block ends in an encoded zero
     std::vector<uint8_t> buffer_;
+    std::vector<uint8_t> inflate_; // decompression target, sized once
+    FramePool* pool_ = nullptr;
+    FramePool::Buffer lease_;
 };
 
 } // namespace spi_eak
@@ -0,0 +1,103 @@
+#include "metrics.h"
+
+namespace spi_eak {
+
+namespace {
+
+std::size_t bucketFor(uint64_t nanoseconds) {
+    if (nanoseconds < 2) {
+        return 0;
+    }
+    const std::size_t bucket = static_cast<std::size_t>(63 - __builtin_clzll(nanoseconds));
+    return bucket < LatencyHistogram::kBuckets ? bucket : LatencyHistogram::kBuckets - 1;
+}
+
+uint64_t load(const std::atomic<uint64_t>& counter) {
+    return counter.load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+void LatencyHistogram::record(uint64_t nanoseconds) noexcept {
+    buckets_[bucketFor(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(nanoseconds, std::memory_order_relaxed);
+    uint64_t previous = max_ns_.load(std::memory_order_relaxed);
+    while (nanoseconds > previous &&
+           !max_ns_.compare_exchange_weak(previous, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const noexcept {
+    // Fields are read independently, so a snapshot taken while writers run
+    // may be off by the samples in flight; it never blocks them.
+    Snapshot snap;
+    for (std::size_t idx = 0; idx < kBuckets; ++idx) {
+        snap.buckets[idx] = load(buckets_[idx]);
+    }
+    snap.count = load(count_);
+    snap.sum_ns = load(sum_ns_);
+    snap.max_ns = load(max_ns_);
+    return snap;
+}
+
+void LatencyHistogram::reset() noexcept {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::Snapshot::percentileNs(double quantile) const {
+    uint64_t total = 0;
+    for (uint64_t bucket : buckets) {
+        total += bucket;
+    }
+    if (total == 0) {
+        return 0;
+    }
+    if (quantile < 0.0) {
+        quantile = 0.0;
+    }
+    const auto target = static_cast<uint64_t>(quantile * static_cast<double>(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (std::size_t idx = 0; idx < kBuckets; ++idx) {
+        seen += buckets[idx];
+        if (seen >= target) {
+            const uint64_t upper = idx + 1 < 64 ? (uint64_t{1} << (idx + 1)) - 1 : ~uint64_t{0};
+            return upper < max_ns ? upper : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+SpiMetrics::Snapshot SpiMetrics::snapshot() const noexcept {
+    Snapshot snap;
+    snap.taken_at = std::chrono::steady_clock::now();
+    snap.ioctl_latency = ioctl_latency.snapshot();
+    snap.messages = load(messages);
+    snap.bytes_clocked = load(bytes_clocked);
+    snap.errors = load(errors);
+    snap.reconfigurations = load(reconfigurations);
+    snap.config_ioctls = load(config_ioctls);
+    return snap;
+}
+
+LinkMetrics::Snapshot LinkMetrics::snapshot() const noexcept {
+    Snapshot snap;
+    snap.taken_at = std::chrono::steady_clock::now();
+    snap.frames_encoded = load(frames_encoded);
+    snap.payload_bytes_encoded = load(payload_bytes_encoded);
+    snap.frame_bytes_encoded = load(frame_bytes_encoded);
+    snap.escape_bytes_encoded = load(escape_bytes_encoded);
+    snap.frames_decoded = load(frames_decoded);
+    snap.payload_bytes_decoded = load(payload_bytes_decoded);
+    for (std::size_t idx = 0; idx < kDropReasons; ++idx) {
+        snap.drops[idx] = load(drops[idx]);
+    }
+    return snap;
+}
+
+} // namespace spi_eak
@@ -0,0 +1,123 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace spi_eak {
+
+/**
+ * Log2-bucketed latency histogram. Bucket i counts samples in
+ * [2^i, 2^(i+1)) nanoseconds (bucket 0 also takes 0). Recording is a handful
+ * of relaxed atomic adds, so writers never block and readers never stall them.
+ */
+class LatencyHistogram {
+public:
+    static constexpr std::size_t kBuckets = 40; // up to ~18 minutes
+
+    struct Snapshot {
+        std::array<uint64_t, kBuckets> buckets{};
+        uint64_t count = 0;
+        uint64_t sum_ns = 0;
+        uint64_t max_ns = 0;
+
+        [[nodiscard]] double meanNs() const {
+            return count ? static_cast<double>(sum_ns) / static_cast<double>(count) : 0.0;
+        }
+
+        /**
+         * Upper bound of the bucket holding the given quantile (0..1).
+         */
+        [[nodiscard]] uint64_t percentileNs(double quantile) const;
+    };
+
+    void record(uint64_t nanoseconds) noexcept;
+    void record(std::chrono::nanoseconds duration) noexcept {
+        record(duration.count() > 0 ? static_cast<uint64_t>(duration.count()) : 0);
+    }
+
+    [[nodiscard]] Snapshot snapshot() const noexcept;
+    void reset() noexcept;
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_ns_{0};
+    std::atomic<uint64_t> max_ns_{0};
+};
+
+/**
+ * Per-SPI-handle counters; attach with SPI::attachMetrics().
+ */
+struct SpiMetrics {
+    LatencyHistogram ioctl_latency; // wall time of each SPI_IOC_MESSAGE
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> bytes_clocked{0}; // full duplex: TX and RX move together
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> reconfigurations{0}; // configureDevice() rounds
+    std::atomic<uint64_t> config_ioctls{0};    // mode/bits/speed writes issued
+
+    struct Snapshot {
+        std::chrono::steady_clock::time_point taken_at;
+        LatencyHistogram::Snapshot ioctl_latency;
+        uint64_t messages = 0;
+        uint64_t bytes_clocked = 0;
+        uint64_t errors = 0;
+        uint64_t reconfigurations = 0;
+        uint64_t config_ioctls = 0;
+    };
+
+    [[nodiscard]] Snapshot snapshot() const noexcept;
+};
+
+/**
+ * Framing counters shared by FrameCodec and FrameDecoder; attach through
+ * FrameCodec::Parameters::metrics.
+ */
+struct LinkMetrics {
+    static constexpr std::size_t kDropReasons = 8; // indexed by FrameDecoder::Result::DropReason
+
+    std::atomic<uint64_t> frames_encoded{0};
+    std::atomic<uint64_t> payload_bytes_encoded{0};
+    std::atomic<uint64_t> frame_bytes_encoded{0};
+    std::atomic<uint64_t> escape_bytes_encoded{0}; // bytes added by escaping
+    std::atomic<uint64_t> frames_decoded{0};
+    std::atomic<uint64_t> payload_bytes_decoded{0};
+    std::array<std::atomic<uint64_t>, kDropReasons> drops{};
+
+    struct Snapshot {
+        std::chrono::steady_clock::time_point taken_at;
+        uint64_t frames_encoded = 0;
+        uint64_t payload_bytes_encoded = 0;
+        uint64_t frame_bytes_encoded = 0;
+        uint64_t escape_bytes_encoded = 0;
+        uint64_t frames_decoded = 0;
+        uint64_t payload_bytes_decoded = 0;
+        std::array<uint64_t, kDropReasons> drops{};
+
+        [[nodiscard]] uint64_t totalDrops() const {
+            uint64_t total = 0;
+            for (uint64_t count : drops) {
+                total += count;
+            }
+            return total;
+        }
+    };
+
+    [[nodiscard]] Snapshot snapshot() const noexcept;
+};
+
+namespace detail {
+
+inline void bump(std::atomic<uint64_t>& counter, uint64_t amount = 1) noexcept {
+    counter.fetch_add(amount, std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+} // namespace spi_eak
+
+#endif // METRICS_H
@@ -0,0 +1,217 @@
+#include "rate_controller.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+namespace spi_eak {
+
+LinkRateController::LinkRateController(SPI& spi, const Options& options)
+    : LinkRateController(
+          [&spi](uint32_t hz) {
+              spi.setSpeed(hz);
+              spi.applyConfig();
+          },
+          options) {}
+
+LinkRateController::LinkRateController(SetSpeed set_speed, const Options& options)
+    : options_(options)
+    , set_speed_(std::move(set_speed)) {
+    if (!set_speed_) {
+        throw std::invalid_argument("LinkRateController needs a way to set the speed");
+    }
+    if (options_.rates.empty()) {
+        throw std::invalid_argument("LinkRateController needs at least one rate");
+    }
+    for (std::size_t idx = 0; idx < options_.rates.size(); ++idx) {
+        if (options_.rates[idx] == 0 || (idx > 0 && options_.rates[idx] <= options_.rates[idx - 1])) {
+            throw std::invalid_argument("LinkRateController rates must be non-zero and strictly ascending");
+        }
+    }
+    if (options_.window_frames == 0 || options_.clean_windows_to_upshift == 0 || options_.burst_step_down == 0) {
+        throw std::invalid_argument("LinkRateController window, upshift and burst step sizes must be non-zero");
+    }
+    if (options_.initial_hz != 0) {
+        const auto found = std::find(options_.rates.begin(), options_.rates.end(), options_.initial_hz);
+        if (found == options_.rates.end()) {
+            throw std::invalid_argument("LinkRateController initial_hz is not one of the rates");
+        }
+        index_ = static_cast<std::size_t>(found - options_.rates.begin());
+    }
+    failures_.assign(options_.rates.size(), 0);
+    set_speed_(options_.rates[index_]);
+}
+
+bool LinkRateController::isLinkError(FrameDecoder::Result::DropReason reason) {
+    using Reason = FrameDecoder::Result::DropReason;
+    return reason == Reason::TooShortForCrc || reason == Reason::CrcMismatch || reason == Reason::FrameTooLarge ||
+           reason == Reason::Malformed;
+}
+
+void LinkRateController::record(const FrameDecoder::Result& result) {
+    if (result.frame_ready) {
+        recordCounts(1, 0);
+    } else if (result.frame_dropped && isLinkError(result.drop_reason)) {
+        recordCounts(0, 1);
+    }
+}
+
+void LinkRateController::recordCounts(uint64_t good, uint64_t errors) {
+    stats_.frames += good;
+    stats_.errors += errors;
+
+    // Feed the batch one window at a time with its errors spread evenly, so
+    // an observe() delta closes every window it spans and the burst test
+    // sees per-window counts. Once the rate moves, the rest of the batch
+    // describes the old rate and is left out of the new windows.
+    const uint64_t total = good + errors;
+    const std::size_t rate = index_;
+    uint64_t done = 0;
+    uint64_t errors_done = 0;
+    while (done < total && index_ == rate) {
+        const uint64_t room = options_.window_frames - (window_good_ + window_errors_);
+        const uint64_t piece = std::min(room, total - done);
+        done += piece;
+        const uint64_t errors_to = static_cast<uint64_t>(
+            std::llround(static_cast<double>(errors) * static_cast<double>(done) / static_cast<double>(total)));
+        const uint64_t piece_errors = std::min(errors_to - errors_done, piece);
+        errors_done += piece_errors;
+        addToWindow(piece - piece_errors, piece_errors);
+    }
+}
+
+void LinkRateController::addToWindow(uint64_t good, uint64_t errors) {
+    window_good_ += good;
+    window_errors_ += errors;
+
+    if (options_.burst_errors > 0 && window_errors_ >= options_.burst_errors) {
+        ++stats_.burst_fallbacks;
+        stepDown(options_.burst_step_down);
+        return;
+    }
+    if (window_good_ + window_errors_ >= options_.window_frames) {
+        closeWindow();
+    }
+}
+
+void LinkRateController::observe(const LinkMetrics::Snapshot& snapshot) {
+    if (!observed_) {
+        observed_ = true;
+        last_snapshot_ = snapshot;
+        return;
+    }
+    const uint64_t good = snapshot.frames_decoded - last_snapshot_.frames_decoded;
+    uint64_t errors = 0;
+    for (std::size_t idx = 0; idx < LinkMetrics::kDropReasons; ++idx) {
+        if (isLinkError(static_cast<FrameDecoder::Result::DropReason>(idx))) {
+            errors += snapshot.drops[idx] - last_snapshot_.drops[idx];
+        }
+    }
+    last_snapshot_ = snapshot;
+    if (good > 0 || errors > 0) {
+        recordCounts(good, errors);
+    }
+}
+
+bool LinkRateController::probe() {
+    if (!options_.probe) {
+        throw std::logic_error("LinkRateController has no probe configured");
+    }
+    ++stats_.probes;
+    const bool clean = options_.probe() == 0;
+    if (!clean) {
+        ++stats_.probe_failures;
+    }
+    recordCounts(clean ? 1 : 0, clean ? 0 : 1);
+    return clean;
+}
+
+LinkRateController::Probe LinkRateController::loopbackProbe(SPI& spi, std::vector<uint8_t> pattern) {
+    if (pattern.empty()) {
+        throw std::invalid_argument("LinkRateController probe pattern must not be empty");
+    }
+    std::vector<uint8_t> rx(pattern.size());
+    return [&spi, pattern = std::move(pattern), rx = std::move(rx)]() mutable {
+        spi.transfer(rx.data(), pattern.data(), pattern.size());
+        uint64_t wrong_bits = 0;
+        for (std::size_t idx = 0; idx < pattern.size(); ++idx) {
+            wrong_bits += static_cast<uint64_t>(__builtin_popcount(static_cast<unsigned>(pattern[idx] ^ rx[idx])));
+        }
+        return wrong_bits;
+    };
+}
+
+void LinkRateController::closeWindow() {
+    ++stats_.windows;
+    const double error_rate =
+        static_cast<double>(window_errors_) / static_cast<double>(window_good_ + window_errors_);
+    resetWindow();
+
+    if (error_rate > options_.downshift_error_rate) {
+        stepDown(1);
+        return;
+    }
+    if (error_rate > options_.upshift_error_rate) {
+        clean_windows_ = 0;
+        return;
+    }
+
+    ++clean_windows_;
+    if (failures_[index_] > 0 && clean_windows_ >= options_.clean_windows_to_upshift << options_.max_backoff_shift) {
+        failures_[index_] = 0;
+    }
+    if (index_ + 1 < options_.rates.size() && clean_windows_ >= requiredCleanWindows(index_ + 1)) {
+        tryStepUp();
+    }
+}
+
+void LinkRateController::stepDown(std::size_t levels) {
+    failures_[index_] = std::min(failures_[index_] + 1, options_.max_backoff_shift);
+    const std::size_t target = index_ > levels ? index_ - levels : 0;
+    if (target != index_) {
+        ++stats_.step_downs;
+        moveTo(target);
+    }
+    clean_windows_ = 0;
+    resetWindow();
+}
+
+void LinkRateController::tryStepUp() {
+    const std::size_t previous = index_;
+    const std::size_t next = index_ + 1;
+    moveTo(next);
+    clean_windows_ = 0;
+    resetWindow();
+
+    if (options_.probe) {
+        uint64_t wrong_bits = 0;
+        for (std::size_t idx = 0; idx < options_.probes_per_upshift; ++idx) {
+            ++stats_.probes;
+            wrong_bits += options_.probe();
+        }
+        if (wrong_bits > 0) {
+            ++stats_.probe_failures;
+            failures_[next] = std::min(failures_[next] + 1, options_.max_backoff_shift);
+            moveTo(previous);
+            return;
+        }
+    }
+    ++stats_.step_ups;
+}
+
+void LinkRateController::moveTo(std::size_t index) {
+    set_speed_(options_.rates[index]);
+    index_ = index;
+}
+
+void LinkRateController::resetWindow() {
+    window_good_ = 0;
+    window_errors_ = 0;
+}
+
+std::size_t LinkRateController::requiredCleanWindows(std::size_t index) const {
+    return options_.clean_windows_to_upshift << failures_[index];
+}
+
+} // namespace spi_eak
@@ -0,0 +1,150 @@
+#ifndef RATE_CONTROLLER_H
+#define RATE_CONTROLLER_H
+
+#include "link_layer.h"
+#include "metrics.h"
+#include "spi.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace spi_eak {
+
+/**
+ * Tunes the SPI clock to the fastest rate a link currently sustains.
+ *
+ * Link health comes in as decoded frames and drops (record(), or observe()
+ * on LinkMetrics snapshots) and, optionally, known-pattern probes. Errors
+ * are the drops a bad bit causes: CRC mismatches, frames too short for
+ * their checksum, oversize frames and malformed COBS blocks. Pool
+ * exhaustion and decompression failures say nothing about the wire and
+ * are ignored.
+ *
+ * The speed moves along an ascending ladder of rates. Health is judged per
+ * window of window_frames samples:
+ *  - a window above downshift_error_rate steps down one rate;
+ *  - burst_errors errors inside one window step down burst_step_down rates
+ *    at once, without waiting for the window to close;
+ *  - clean_windows_to_upshift windows in a row at or below
+ *    upshift_error_rate step up one rate, after the probe (if any) passes
+ *    at the new rate.
+ * Between the two thresholds the rate holds. Every failure at a rate (a
+ * downshift from it, or a failed probe into it) doubles the clean windows
+ * required before it is tried again, up to 2^max_backoff_shift; the
+ * penalty clears once the rate has held clean for that longest back-off.
+ *
+ * Speed changes go through SPI::setSpeed() and applyConfig(). Not
+ * thread-safe: feed it from the thread that owns the link.
+ */
+class LinkRateController {
+public:
+    /**
+     * Runs one probe exchange at the current speed; returns the number of
+     * bits that came back wrong (0 = clean).
+     */
+    using Probe = std::function<uint64_t()>;
+
+    /**
+     * Applies a new clock rate; throws on failure.
+     */
+    using SetSpeed = std::function<void(uint32_t hz)>;
+
+    struct Options {
+        std::vector<uint32_t> rates;               // ascending candidate speeds, Hz
+        uint32_t initial_hz = 0;                   // must be in `rates`; 0 -> the lowest
+        std::size_t window_frames = 256;
+        double downshift_error_rate = 0.01;
+        double upshift_error_rate = 0.0;
+        std::size_t clean_windows_to_upshift = 4;
+        std::size_t burst_errors = 16;             // errors in one window that force a fast fallback; 0 disables
+        std::size_t burst_step_down = 2;
+        std::size_t max_backoff_shift = 5;
+        std::size_t probes_per_upshift = 4;
+        Probe probe;                               // optional; gates every step up
+    };
+
+    struct Stats {
+        uint64_t frames = 0;          // good samples seen
+        uint64_t errors = 0;          // error samples seen
+        uint64_t windows = 0;
+        uint64_t step_ups = 0;
+        uint64_t step_downs = 0;      // includes burst fallbacks
+        uint64_t burst_fallbacks = 0;
+        uint64_t probes = 0;
+        uint64_t probe_failures = 0;
+    };
+
+    /**
+     * Throws std::invalid_argument for an empty or unsorted ladder, an
+     * initial rate off the ladder or zero window sizes. The initial rate is
+     * applied immediately.
+     */
+    LinkRateController(SPI& spi, const Options& options);
+    LinkRateController(SetSpeed set_speed, const Options& options);
+
+    /**
+     * One decoder result; results that are neither a frame nor a drop are
+     * ignored.
+     */
+    void record(const FrameDecoder::Result& result);
+
+    /**
+     * A batch of good frames and link errors. The batch is split at window
+     * boundaries with its errors spread evenly across it, since their order
+     * is unknown; whatever remains after a rate change is not judged
+     * against the new rate.
+     */
+    void recordCounts(uint64_t good, uint64_t errors);
+
+    /**
+     * Feed the decoder counters accumulated since the previous observe().
+     * The first call only sets the reference point.
+     */
+    void observe(const LinkMetrics::Snapshot& snapshot);
+
+    /**
+     * Run one probe at the current speed and count it as a good or bad
+     * sample. Returns false when it saw bit errors; throws std::logic_error
+     * when no probe is configured.
+     */
+    bool probe();
+
+    /**
+     * Probe that sends `pattern` and expects it back unchanged, for a peer
+     * wired or commanded to loop MOSI back to MISO. `spi` must outlive it.
+     */
+    static Probe loopbackProbe(SPI& spi, std::vector<uint8_t> pattern);
+
+    [[nodiscard]] uint32_t speed() const noexcept { return options_.rates[index_]; }
+    [[nodiscard]] std::size_t rateIndex() const noexcept { return index_; }
+    [[nodiscard]] const Stats& stats() const noexcept { return stats_; }
+    [[nodiscard]] const Options& options() const noexcept { return options_; }
+
+private:
+    static bool isLinkError(FrameDecoder::Result::DropReason reason);
+
+    void addToWindow(uint64_t good, uint64_t errors);
+    void closeWindow();
+    void stepDown(std::size_t levels);
+    void tryStepUp();
+    void moveTo(std::size_t index);
+    void resetWindow();
+    std::size_t requiredCleanWindows(std::size_t index) const;
+
+    Options options_;
+    SetSpeed set_speed_;
+    Stats stats_;
+    std::size_t index_ = 0;
+    std::vector<std::size_t> failures_; // back-off exponent per rate
+    uint64_t window_good_ = 0;
+    uint64_t window_errors_ = 0;
+    std::size_t clean_windows_ = 0;
+    bool observed_ = false;
+    LinkMetrics::Snapshot last_snapshot_;
+};
+
+} // namespace spi_eak
+
+#endif // RATE_CONTROLLER_H
@@ -0,0 +1,38 @@
+#include "realtime.h"
+#include "sys_util.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace spi_eak {
+
+void applyThreadPolicy(const ThreadPolicy& policy) {
+    if (policy.cpu >= 0) {
+        if (policy.cpu >= CPU_SETSIZE) {
+            throw std::invalid_argument("CPU index exceeds CPU_SETSIZE");
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(policy.cpu, &set);
+        const int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            throw std::runtime_error("Failed to pin thread to CPU " + std::to_string(policy.cpu) +
+                                     ": " + detail::errnoMessage(err));
+        }
+    }
+    if (policy.realtime_priority > 0) {
+        sched_param param{};
+        param.sched_priority = policy.realtime_priority;
+        const int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0) {
+            throw std::runtime_error("Failed to enable SCHED_FIFO priority " +
+                                     std::to_string(policy.realtime_priority) + ": " +
+                                     detail::errnoMessage(err));
+        }
+    }
+}
+
+} // namespace spi_eak
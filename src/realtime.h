@@ -0,0 +1,24 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+namespace spi_eak {
+
+/**
+ * Scheduling knobs for threads that own bus time. Defaults leave the thread
+ * untouched.
+ */
+struct ThreadPolicy {
+    int cpu = -1;              // pin to this CPU; -1 keeps the inherited affinity
+    int realtime_priority = 0; // >0 switches to SCHED_FIFO at this priority
+};
+
+/**
+ * Apply a ThreadPolicy to the calling thread.
+ * Throws std::runtime_error when the kernel refuses (e.g. missing
+ * CAP_SYS_NICE for SCHED_FIFO or an offline CPU).
+ */
+void applyThreadPolicy(const ThreadPolicy& policy);
+
+} // namespace spi_eak
+
+#endif // REALTIME_H
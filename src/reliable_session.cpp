@@ -0,0 +1,383 @@
+#include "reliable_session.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace spi_eak {
+
+namespace {
+
+constexpr uint8_t kFlagData = 0x01;
+constexpr uint8_t kFlagNack = 0x02;
+
+void put16(uint8_t* out, uint16_t value) {
+    out[0] = static_cast<uint8_t>(value >> 8);
+    out[1] = static_cast<uint8_t>(value);
+}
+
+void put32(uint8_t* out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value >> 24);
+    out[1] = static_cast<uint8_t>(value >> 16);
+    out[2] = static_cast<uint8_t>(value >> 8);
+    out[3] = static_cast<uint8_t>(value);
+}
+
+uint16_t get16(const uint8_t* in) {
+    return static_cast<uint16_t>((in[0] << 8) | in[1]);
+}
+
+uint32_t get32(const uint8_t* in) {
+    return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+           (static_cast<uint32_t>(in[2]) << 8) | in[3];
+}
+
+FrameDecoder::Options decoderOptions(const ReliableSession::Options& options) {
+    FrameDecoder::Options decoder;
+    decoder.params = options.params;
+    decoder.max_frame_bytes = ReliableSession::kHeaderBytes + options.max_payload_bytes +
+                              FrameCodec::checksumBytes(options.params) +
+                              FrameCodec::compressionBytes(options.params);
+    return decoder;
+}
+
+} // namespace
+
+ReliableSession::ReliableSession(SPI& spi, const Options& options)
+    : ReliableSession(Transfer([&spi](uint8_t* rx, const uint8_t* tx, std::size_t length) {
+                          spi.transfer(rx, tx, length);
+                      }),
+                      options) {}
+
+ReliableSession::ReliableSession(Transfer transfer, const Options& options)
+    : options_(options)
+    , transfer_(std::move(transfer))
+    , decoder_(decoderOptions(options)) {
+    if (!transfer_) {
+        throw std::invalid_argument("ReliableSession requires a transfer function");
+    }
+    // Slots are indexed by sequence modulo the window, which must divide the
+    // 16-bit sequence space to stay consistent across wrap-around.
+    if (options_.window == 0 || options_.window > kMaxWindow ||
+        (options_.window & (options_.window - 1)) != 0) {
+        throw std::invalid_argument("ReliableSession window must be a power of two up to 32");
+    }
+    if (options_.max_payload_bytes == 0 || options_.transfer_bytes == 0) {
+        throw std::invalid_argument("ReliableSession payload and transfer sizes must be non-zero");
+    }
+    if (!options_.params.enable_crc16) {
+        throw std::invalid_argument("ReliableSession needs a frame checksum to detect corruption");
+    }
+    if (!FrameCodec::isIdleFill(options_.fill_byte, options_.params)) {
+        throw std::invalid_argument("ReliableSession fill byte would be read as frame data");
+    }
+    if (FrameCodec::encodedSize(nullptr, 0, options_.params) == 0) {
+        throw std::invalid_argument("ReliableSession framing parameters are invalid");
+    }
+
+    tx_slots_.resize(options_.window);
+    rx_slots_.resize(options_.window);
+    for (std::size_t idx = 0; idx < options_.window; ++idx) {
+        tx_slots_[idx].payload.reserve(options_.max_payload_bytes);
+        rx_slots_[idx].payload.reserve(options_.max_payload_bytes);
+    }
+    const std::size_t frame_bytes = kHeaderBytes + options_.max_payload_bytes;
+    tx_stream_.resize(options_.transfer_bytes + FrameCodec::maxEncodedSize(frame_bytes, options_.params));
+    header_payload_.reserve(frame_bytes);
+    tx_buffer_.resize(options_.transfer_bytes);
+    rx_buffer_.resize(options_.transfer_bytes);
+    rx_frame_.reserve(decoderOptions(options_).max_frame_bytes);
+}
+
+bool ReliableSession::send(const uint8_t* payload, std::size_t length) {
+    if (length > options_.max_payload_bytes) {
+        throw std::invalid_argument("ReliableSession payload exceeds max_payload_bytes");
+    }
+    if (!payload && length > 0) {
+        throw std::invalid_argument("ReliableSession::send needs a payload pointer");
+    }
+    if (inFlight() >= options_.window) {
+        return false;
+    }
+    TxSlot& slot = txSlot(next_seq_);
+    slot.payload.assign(payload, payload + length);
+    slot.transmissions = 0;
+    slot.acked = false;
+    slot.resend = false;
+    ++next_seq_;
+    return true;
+}
+
+ReliableSession::ExchangeResult ReliableSession::exchange(const DeliverCallback& on_deliver) {
+    return exchange(Clock::now(), on_deliver);
+}
+
+ReliableSession::ExchangeResult ReliableSession::exchange(Clock::time_point now,
+                                                          const DeliverCallback& on_deliver) {
+    ExchangeResult result;
+    checkTimers(now);
+    stageFrames(now, result);
+
+    const std::size_t length = options_.transfer_bytes;
+    result.frame_bytes_sent = std::min(pendingTxBytes(), length);
+    std::memcpy(tx_buffer_.data(), tx_stream_.data() + tx_head_, result.frame_bytes_sent);
+    result.fill_bytes_sent = length - result.frame_bytes_sent;
+    std::memset(tx_buffer_.data() + result.frame_bytes_sent, options_.fill_byte, result.fill_bytes_sent);
+
+    transfer_(rx_buffer_.data(), tx_buffer_.data(), length);
+
+    tx_head_ += result.frame_bytes_sent;
+    if (tx_head_ == tx_tail_) {
+        tx_head_ = 0;
+        tx_tail_ = 0;
+    }
+
+    decoder_.decode(rx_buffer_.data(), length, rx_frame_, [&](const FrameDecoder::Result& frame_result) {
+        if (frame_result.frame_ready) {
+            handleFrame(rx_frame_, now, on_deliver, result);
+        } else {
+            ++result.frames_dropped;
+            ++stats_.frames_dropped;
+        }
+    });
+    return result;
+}
+
+void ReliableSession::checkTimers(Clock::time_point now) {
+    for (uint16_t seq = send_base_; seq != next_new_; ++seq) {
+        TxSlot& slot = txSlot(seq);
+        if (!slot.acked && !slot.resend && now - slot.sent_at >= options_.retransmit_timeout) {
+            slot.resend = true;
+            ++stats_.timeouts;
+        }
+    }
+}
+
+void ReliableSession::stageFrames(Clock::time_point now, ExchangeResult& result) {
+    // Keep at most one transfer's worth staged so ACKs stay fresh.
+    auto room = [&]() { return pendingTxBytes() < options_.transfer_bytes; };
+    auto stageData = [&](uint16_t seq) {
+        TxSlot& slot = txSlot(seq);
+        stageFrame(true, seq, slot.payload.data(), slot.payload.size());
+        slot.resend = false;
+        slot.sent_at = now;
+        ++slot.transmissions;
+        ++stats_.frames_sent;
+        ++result.frames_sent;
+    };
+
+    for (uint16_t seq = send_base_; seq != next_new_ && room(); ++seq) {
+        const TxSlot& slot = txSlot(seq);
+        if (!slot.acked && slot.resend) {
+            stageData(seq);
+            ++stats_.retransmits;
+        }
+    }
+    while (next_new_ != next_seq_ && room()) {
+        stageData(next_new_);
+        ++next_new_;
+    }
+    if (ack_owed_ && room()) {
+        stageFrame(false, 0, nullptr, 0);
+        ++stats_.acks_sent;
+        ++result.acks_sent;
+    }
+}
+
+void ReliableSession::stageFrame(bool data, uint16_t seq, const uint8_t* payload, std::size_t length) {
+    header_payload_.resize(kHeaderBytes + length);
+    uint8_t* header = header_payload_.data();
+    header[0] = static_cast<uint8_t>((data ? kFlagData : 0) | (nack_owed_ ? kFlagNack : 0));
+    put16(header + 1, seq);
+    put16(header + 3, recv_base_);
+    put32(header + 5, sackBitmap());
+    if (length > 0) {
+        std::memcpy(header + kHeaderBytes, payload, length);
+    }
+
+    const std::size_t needed = FrameCodec::maxEncodedSize(header_payload_.size(), options_.params);
+    if (needed > tx_stream_.size() - tx_tail_) {
+        std::memmove(tx_stream_.data(), tx_stream_.data() + tx_head_, pendingTxBytes());
+        tx_tail_ -= tx_head_;
+        tx_head_ = 0;
+    }
+    const auto encoded = FrameCodec::encodeInto(header_payload_.data(), header_payload_.size(),
+                                                tx_stream_.data() + tx_tail_, tx_stream_.size() - tx_tail_,
+                                                options_.params);
+    if (!encoded.ok) {
+        throw std::invalid_argument("ReliableSession framing parameters are invalid");
+    }
+    tx_tail_ += encoded.bytes_written;
+    ack_owed_ = false;
+    nack_owed_ = false;
+}
+
+void ReliableSession::handleFrame(const std::vector<uint8_t>& frame,
+                                  Clock::time_point now,
+                                  const DeliverCallback& on_deliver,
+                                  ExchangeResult& result) {
+    if (frame.size() < kHeaderBytes) {
+        ++result.frames_dropped;
+        ++stats_.frames_dropped;
+        return;
+    }
+    const uint8_t flags = frame[0];
+    applyAck(get16(frame.data() + 3), get32(frame.data() + 5), (flags & kFlagNack) != 0, now);
+    if (flags & kFlagData) {
+        acceptData(get16(frame.data() + 1), frame.data() + kHeaderBytes, frame.size() - kHeaderBytes,
+                   on_deliver, result);
+    }
+}
+
+void ReliableSession::applyAck(uint16_t ack, uint32_t sack, bool nack, Clock::time_point now) {
+    const uint16_t sent = static_cast<uint16_t>(next_new_ - send_base_);
+    if (static_cast<uint16_t>(ack - send_base_) > sent) {
+        return; // stale, from before our window moved
+    }
+    auto ackSeq = [&](uint16_t seq) {
+        if (static_cast<uint16_t>(seq - send_base_) >= sent) {
+            return;
+        }
+        TxSlot& slot = txSlot(seq);
+        if (!slot.acked) {
+            slot.acked = true;
+            ++stats_.frames_acked;
+        }
+    };
+    for (uint16_t seq = send_base_; seq != ack; ++seq) {
+        ackSeq(seq);
+    }
+    uint16_t highest = ack; // one past the newest frame the peer holds
+    for (unsigned bit = 0; bit < 32; ++bit) {
+        if (sack & (1u << bit)) {
+            const uint16_t seq = static_cast<uint16_t>(ack + 1 + bit);
+            ackSeq(seq);
+            highest = static_cast<uint16_t>(seq + 1);
+        }
+    }
+
+    // Anything unacked below the newest frame the peer holds was lost.
+    if (nack && highest == ack) {
+        markMissing(ack, now);
+    }
+    for (uint16_t seq = ack; seq != highest; ++seq) {
+        markMissing(seq, now);
+    }
+
+    while (send_base_ != next_new_ && txSlot(send_base_).acked) {
+        ++send_base_;
+    }
+}
+
+void ReliableSession::markMissing(uint16_t seq, Clock::time_point now) {
+    if (static_cast<uint16_t>(seq - send_base_) >= static_cast<uint16_t>(next_new_ - send_base_)) {
+        return;
+    }
+    TxSlot& slot = txSlot(seq);
+    if (slot.acked || slot.resend || now - slot.sent_at < options_.nack_holdoff) {
+        return;
+    }
+    slot.resend = true;
+    ++stats_.fast_retransmits;
+}
+
+void ReliableSession::acceptData(uint16_t seq,
+                                 const uint8_t* payload,
+                                 std::size_t length,
+                                 const DeliverCallback& on_deliver,
+                                 ExchangeResult& result) {
+    ack_owed_ = true;
+    const uint16_t offset = static_cast<uint16_t>(seq - recv_base_);
+    if (offset >= options_.window) {
+        ++stats_.duplicates; // already delivered; our ACK must have been lost
+        return;
+    }
+
+    if (offset > 0) {
+        RxSlot& slot = rxSlot(seq);
+        if (slot.present) {
+            ++stats_.duplicates;
+            return;
+        }
+        slot.payload.assign(payload, payload + length);
+        slot.present = true;
+        ++stats_.out_of_order;
+        nack_owed_ = true;
+        return;
+    }
+
+    auto deliver = [&](const uint8_t* data, std::size_t size) {
+        if (on_deliver) {
+            on_deliver(data, size);
+        }
+        ++recv_base_;
+        ++result.delivered;
+        ++stats_.delivered;
+    };
+    deliver(payload, length);
+    while (rxSlot(recv_base_).present) {
+        RxSlot& slot = rxSlot(recv_base_);
+        slot.present = false;
+        deliver(slot.payload.data(), slot.payload.size());
+    }
+}
+
+uint32_t ReliableSession::sackBitmap() const {
+    uint32_t bitmap = 0;
+    for (std::size_t bit = 0; bit + 1 < options_.window; ++bit) {
+        if (rx_slots_[static_cast<uint16_t>(recv_base_ + 1 + bit) % options_.window].present) {
+            bitmap |= 1u << bit;
+        }
+    }
+    return bitmap;
+}
+
+LossyLoopback::LossyLoopback()
+    : LossyLoopback(Options{}) {}
+
+LossyLoopback::LossyLoopback(const Options& options)
+    : options_(options)
+    , rng_(options.seed)
+    , gap_(options.bit_error_rate > 0.0 && options.bit_error_rate <= 1.0 ? options.bit_error_rate : 1.0) {
+    if (options_.bit_error_rate < 0.0 || options_.bit_error_rate > 1.0) {
+        throw std::invalid_argument("LossyLoopback bit_error_rate must be within [0, 1]");
+    }
+    if (options_.bit_error_rate > 0.0) {
+        bits_to_next_error_ = gap_(rng_);
+    }
+}
+
+ReliableSession::Transfer LossyLoopback::endpointA() {
+    return [this](uint8_t* rx, const uint8_t* tx, std::size_t length) { move(a_to_b_, b_to_a_, rx, tx, length); };
+}
+
+ReliableSession::Transfer LossyLoopback::endpointB() {
+    return [this](uint8_t* rx, const uint8_t* tx, std::size_t length) { move(b_to_a_, a_to_b_, rx, tx, length); };
+}
+
+void LossyLoopback::move(std::deque<uint8_t>& outgoing,
+                         std::deque<uint8_t>& incoming,
+                         uint8_t* rx,
+                         const uint8_t* tx,
+                         std::size_t length) {
+    for (std::size_t idx = 0; idx < length; ++idx) {
+        uint8_t byte = tx[idx];
+        if (options_.bit_error_rate > 0.0) {
+            while (bits_to_next_error_ < 8) {
+                byte = static_cast<uint8_t>(byte ^ (1u << bits_to_next_error_));
+                ++bits_flipped_;
+                bits_to_next_error_ += 1 + gap_(rng_);
+            }
+            bits_to_next_error_ -= 8;
+        }
+        outgoing.push_back(byte);
+    }
+
+    const std::size_t available = std::min(length, incoming.size());
+    std::copy(incoming.begin(), incoming.begin() + static_cast<std::ptrdiff_t>(available), rx);
+    incoming.erase(incoming.begin(), incoming.begin() + static_cast<std::ptrdiff_t>(available));
+    std::fill(rx + available, rx + length, options_.fill_byte);
+}
+
+} // namespace spi_eak
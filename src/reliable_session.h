@@ -0,0 +1,211 @@
+#ifndef RELIABLE_SESSION_H
+#define RELIABLE_SESSION_H
+
+#include "link_layer.h"
+#include "spi.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace spi_eak {
+
+/**
+ * Selective-repeat reliable delivery over a full-duplex framed link.
+ *
+ * Every frame carries a small header ahead of the payload: a sequence
+ * number, the cumulative ACK of the peer's stream (next sequence expected),
+ * a 32-bit selective-ACK bitmap for the frames after it, and a NACK flag set
+ * when a gap is seen. ACKs ride on data frames going the other way, with
+ * ACK-only frames sent when there is nothing else to say. Up to `window`
+ * frames may be unacknowledged; a frame is retransmitted when its timer
+ * expires or as soon as the peer's ACKs show it missing, so one lost frame
+ * does not stall the pipeline behind it. Delivery is in order and exactly
+ * once.
+ *
+ * Frames go through FrameCodec/FrameDecoder with `params`; a checksum must
+ * be enabled, since corrupted frames are only detected by it.
+ */
+class ReliableSession {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Transfer = std::function<void(uint8_t* rx, const uint8_t* tx, std::size_t length)>;
+
+    static constexpr std::size_t kHeaderBytes = 9;
+    static constexpr std::size_t kMaxWindow = 32;
+
+    struct Options {
+        FrameCodec::Parameters params;
+        std::size_t max_payload_bytes = 1024;
+        std::size_t window = 16;                               // 1..kMaxWindow frames in flight
+        std::chrono::microseconds retransmit_timeout{5000};
+        std::chrono::microseconds nack_holdoff{1000};          // min gap between gap-driven resends of a frame
+        std::size_t transfer_bytes = 256;                      // bytes clocked per exchange()
+        uint8_t fill_byte = 0x00;                              // idle filler; see FrameCodec::isIdleFill()
+    };
+
+    /**
+     * Receives payloads in order; `payload` is valid only during the call.
+     */
+    using DeliverCallback = std::function<void(const uint8_t* payload, std::size_t length)>;
+
+    struct ExchangeResult {
+        std::size_t frames_sent = 0;   // data frames, including retransmissions
+        std::size_t acks_sent = 0;     // ACK-only frames
+        std::size_t frame_bytes_sent = 0;
+        std::size_t fill_bytes_sent = 0;
+        std::size_t delivered = 0;
+        std::size_t frames_dropped = 0; // decoder drops (CRC mismatch and friends)
+    };
+
+    struct Stats {
+        uint64_t frames_sent = 0;
+        uint64_t retransmits = 0;      // data frames sent more than once
+        uint64_t timeouts = 0;         // retransmissions triggered by the timer
+        uint64_t fast_retransmits = 0; // retransmissions triggered by NACK/SACK gaps
+        uint64_t acks_sent = 0;
+        uint64_t frames_acked = 0;
+        uint64_t delivered = 0;
+        uint64_t duplicates = 0;       // data frames received more than once
+        uint64_t out_of_order = 0;     // data frames buffered ahead of a gap
+        uint64_t frames_dropped = 0;
+    };
+
+    ReliableSession(SPI& spi, const Options& options);
+    ReliableSession(Transfer transfer, const Options& options);
+
+    /**
+     * Queue a payload for reliable delivery. Returns false when the window
+     * is full; throws std::invalid_argument above max_payload_bytes.
+     */
+    bool send(const uint8_t* payload, std::size_t length);
+    bool send(const std::vector<uint8_t>& payload) { return send(payload.data(), payload.size()); }
+
+    /**
+     * Clock one transfer_bytes transfer: due retransmissions first, then new
+     * frames while the window allows, then a bare ACK if one is owed; RX is
+     * decoded, ACKs are applied and in-order payloads are delivered.
+     * Transfer errors propagate as exceptions.
+     */
+    ExchangeResult exchange(const DeliverCallback& on_deliver);
+    ExchangeResult exchange(Clock::time_point now, const DeliverCallback& on_deliver);
+
+    /**
+     * Frames sent or queued but not yet acknowledged.
+     */
+    [[nodiscard]] std::size_t inFlight() const noexcept {
+        return static_cast<uint16_t>(next_seq_ - send_base_);
+    }
+    [[nodiscard]] bool idle() const noexcept { return inFlight() == 0 && pendingTxBytes() == 0; }
+    [[nodiscard]] const Stats& stats() const noexcept { return stats_; }
+    [[nodiscard]] const Options& options() const noexcept { return options_; }
+
+private:
+    struct TxSlot {
+        std::vector<uint8_t> payload;
+        Clock::time_point sent_at{};
+        uint32_t transmissions = 0;
+        bool acked = false;
+        bool resend = false;
+    };
+
+    struct RxSlot {
+        std::vector<uint8_t> payload;
+        bool present = false;
+    };
+
+    std::size_t pendingTxBytes() const noexcept { return tx_tail_ - tx_head_; }
+    TxSlot& txSlot(uint16_t seq) { return tx_slots_[seq % options_.window]; }
+    RxSlot& rxSlot(uint16_t seq) { return rx_slots_[seq % options_.window]; }
+
+    void checkTimers(Clock::time_point now);
+    void stageFrames(Clock::time_point now, ExchangeResult& result);
+    void stageFrame(bool data, uint16_t seq, const uint8_t* payload, std::size_t length);
+    void handleFrame(const std::vector<uint8_t>& frame,
+                     Clock::time_point now,
+                     const DeliverCallback& on_deliver,
+                     ExchangeResult& result);
+    void applyAck(uint16_t ack, uint32_t sack, bool nack, Clock::time_point now);
+    void markMissing(uint16_t seq, Clock::time_point now);
+    void acceptData(uint16_t seq,
+                    const uint8_t* payload,
+                    std::size_t length,
+                    const DeliverCallback& on_deliver,
+                    ExchangeResult& result);
+    uint32_t sackBitmap() const;
+
+    Options options_;
+    Transfer transfer_;
+    FrameDecoder decoder_;
+    Stats stats_;
+
+    // Sender: send_base_ .. next_seq_ are in flight, next_new_ is the first
+    // never transmitted.
+    std::vector<TxSlot> tx_slots_;
+    uint16_t send_base_ = 0;
+    uint16_t next_new_ = 0;
+    uint16_t next_seq_ = 0;
+
+    // Receiver: recv_base_ is the next sequence to deliver.
+    std::vector<RxSlot> rx_slots_;
+    uint16_t recv_base_ = 0;
+    bool ack_owed_ = false;
+    bool nack_owed_ = false;
+
+    std::vector<uint8_t> tx_stream_; // encoded frames not yet clocked out
+    std::size_t tx_head_ = 0;
+    std::size_t tx_tail_ = 0;
+    std::vector<uint8_t> header_payload_;
+    std::vector<uint8_t> tx_buffer_;
+    std::vector<uint8_t> rx_buffer_;
+    std::vector<uint8_t> rx_frame_;
+};
+
+/**
+ * In-memory full-duplex loopback between two endpoints, with optional bit
+ * errors, for exercising ReliableSession (or FramedLink) without hardware.
+ * Bytes written by one endpoint are read by the other on its next
+ * transfers; an endpoint with nothing to read sees fill_byte.
+ */
+class LossyLoopback {
+public:
+    struct Options {
+        double bit_error_rate = 0.0; // independent per bit, applied on the way across
+        uint32_t seed = 1;
+        uint8_t fill_byte = 0x00;
+    };
+
+    LossyLoopback();
+    explicit LossyLoopback(const Options& options);
+
+    /**
+     * Transfer functions for the two ends; the loopback must outlive them.
+     */
+    ReliableSession::Transfer endpointA();
+    ReliableSession::Transfer endpointB();
+
+    [[nodiscard]] uint64_t bitsFlipped() const noexcept { return bits_flipped_; }
+
+private:
+    void move(std::deque<uint8_t>& outgoing,
+              std::deque<uint8_t>& incoming,
+              uint8_t* rx,
+              const uint8_t* tx,
+              std::size_t length);
+
+    Options options_;
+    std::mt19937 rng_;
+    std::geometric_distribution<uint64_t> gap_;
+    uint64_t bits_to_next_error_ = 0;
+    uint64_t bits_flipped_ = 0;
+    std::deque<uint8_t> a_to_b_;
+    std::deque<uint8_t> b_to_a_;
+};
+
+} // namespace spi_eak
+
+#endif // RELIABLE_SESSION_H
@@ -0,0 +1,320 @@
+#include "sim_spi.h"
+
+#include <linux/spi/spidev.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+namespace spi_eak {
+
+namespace {
+
+// Waits shorter than this are spun; longer ones sleep most of the way.
+constexpr std::chrono::microseconds kSpinWindow{200};
+
+std::size_t bytesPerWord(uint8_t bits) {
+    return bits <= 8 ? 1 : bits <= 16 ? 2 : 4;
+}
+
+bool overlaps(const uint8_t* a, const uint8_t* b, std::size_t length) {
+    return a < b + length && b < a + length;
+}
+
+} // namespace
+
+void LoopbackPeer::clock(const uint8_t* mosi, uint8_t* miso, std::size_t length,
+                         uint64_t /*start_ns*/, double /*ns_per_byte*/) {
+    std::memcpy(miso, mosi, length);
+}
+
+EchoPeer::EchoPeer(std::chrono::nanoseconds latency, uint8_t fill_byte)
+    : latency_ns_(static_cast<uint64_t>(std::max<int64_t>(latency.count(), 0)))
+    , fill_byte_(fill_byte) {}
+
+void EchoPeer::clock(const uint8_t* mosi, uint8_t* miso, std::size_t length,
+                     uint64_t start_ns, double ns_per_byte) {
+    for (std::size_t idx = 0; idx < length; ++idx) {
+        const uint64_t at = start_ns + static_cast<uint64_t>(static_cast<double>(idx) * ns_per_byte);
+        if (!pending_.empty() && pending_.front().first <= at) {
+            miso[idx] = pending_.front().second;
+            pending_.pop_front();
+        } else {
+            miso[idx] = fill_byte_;
+        }
+        pending_.emplace_back(at + latency_ns_, mosi[idx]);
+    }
+}
+
+BitErrorPeer::BitErrorPeer(std::shared_ptr<SimPeer> inner, double bit_error_rate, uint32_t seed)
+    : inner_(std::move(inner))
+    , rng_(seed) {
+    if (!inner_) {
+        throw std::invalid_argument("BitErrorPeer needs an inner peer");
+    }
+    if (bit_error_rate < 0.0 || bit_error_rate > 1.0) {
+        throw std::invalid_argument("BitErrorPeer bit_error_rate must be within [0, 1]");
+    }
+    setRate(bit_error_rate);
+}
+
+BitErrorPeer::BitErrorPeer(std::shared_ptr<SimPeer> inner, RateModel model, uint32_t seed)
+    : inner_(std::move(inner))
+    , model_(std::move(model))
+    , rng_(seed) {
+    if (!inner_) {
+        throw std::invalid_argument("BitErrorPeer needs an inner peer");
+    }
+    if (!model_) {
+        throw std::invalid_argument("BitErrorPeer needs a rate model");
+    }
+}
+
+BitErrorPeer::RateModel BitErrorPeer::kneeModel(double knee_hz, double ber_at_knee, double hz_per_decade) {
+    if (knee_hz <= 0.0 || ber_at_knee < 0.0 || hz_per_decade <= 0.0) {
+        throw std::invalid_argument("BitErrorPeer::kneeModel needs positive knee and slope");
+    }
+    return [=](double clock_hz) {
+        return std::min(0.5, ber_at_knee * std::pow(10.0, (clock_hz - knee_hz) / hz_per_decade));
+    };
+}
+
+void BitErrorPeer::setRate(double bit_error_rate) {
+    if (bit_error_rate == bit_error_rate_) {
+        return;
+    }
+    bit_error_rate_ = bit_error_rate;
+    if (bit_error_rate_ > 0.0) {
+        gap_ = std::geometric_distribution<uint64_t>(bit_error_rate_);
+        bits_to_next_error_ = gap_(rng_);
+    }
+}
+
+void BitErrorPeer::clock(const uint8_t* mosi, uint8_t* miso, std::size_t length,
+                         uint64_t start_ns, double ns_per_byte) {
+    if (model_ && ns_per_byte > 0.0) {
+        // Byte time back to a bit clock; exact for 8-, 16- and 32-bit words.
+        setRate(std::clamp(model_(8e9 / ns_per_byte), 0.0, 1.0));
+    }
+    if (bit_error_rate_ <= 0.0) {
+        inner_->clock(mosi, miso, length, start_ns, ns_per_byte);
+        return;
+    }
+    mosi_.assign(mosi, mosi + length);
+    corrupt(mosi_.data(), length);
+    inner_->clock(mosi_.data(), miso, length, start_ns, ns_per_byte);
+    corrupt(miso, length);
+}
+
+void BitErrorPeer::chipSelect(bool asserted, uint64_t now_ns) {
+    inner_->chipSelect(asserted, now_ns);
+}
+
+void BitErrorPeer::corrupt(uint8_t* data, std::size_t length) {
+    const uint64_t total_bits = static_cast<uint64_t>(length) * 8;
+    uint64_t bit = bits_to_next_error_;
+    while (bit < total_bits) {
+        data[bit / 8] = static_cast<uint8_t>(data[bit / 8] ^ (1u << (bit % 8)));
+        ++bits_flipped_;
+        bit += 1 + gap_(rng_);
+    }
+    bits_to_next_error_ = bit - total_bits;
+}
+
+ScriptedPeer::ScriptedPeer(Script script)
+    : script_(std::move(script)) {
+    if (!script_) {
+        throw std::invalid_argument("ScriptedPeer needs a script");
+    }
+}
+
+void ScriptedPeer::clock(const uint8_t* mosi, uint8_t* miso, std::size_t length,
+                         uint64_t start_ns, double ns_per_byte) {
+    script_(mosi, miso, length, start_ns, ns_per_byte);
+}
+
+SimulatedSpiDevice::SimulatedSpiDevice()
+    : SimulatedSpiDevice(Options{}) {}
+
+SimulatedSpiDevice::SimulatedSpiDevice(const Options& options, std::shared_ptr<SimPeer> peer)
+    : options_(options)
+    , peer_(std::move(peer))
+    , max_speed_hz_(options.controller_max_hz)
+    , epoch_(Clock::now()) {
+    if (options_.bufsiz == 0) {
+        throw std::invalid_argument("SimulatedSpiDevice bufsiz must be non-zero");
+    }
+    if (options_.controller_max_hz == 0) {
+        throw std::invalid_argument("SimulatedSpiDevice controller_max_hz must be non-zero");
+    }
+}
+
+void SimulatedSpiDevice::setPeer(std::shared_ptr<SimPeer> peer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    peer_ = std::move(peer);
+}
+
+int SimulatedSpiDevice::reject(int err) {
+    ++stats_.rejected;
+    errno = err;
+    return -1;
+}
+
+void SimulatedSpiDevice::setChipSelect(bool asserted, uint64_t now_ns) {
+    if (cs_asserted_ == asserted) {
+        return;
+    }
+    cs_asserted_ = asserted;
+    if (peer_) {
+        peer_->chipSelect(asserted, now_ns);
+    }
+}
+
+int SimulatedSpiDevice::message(spi_ioc_transfer* ops, std::size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (count == 0) {
+        return 0;
+    }
+    if (!ops) {
+        return reject(EFAULT);
+    }
+
+    // Same checks spidev and the SPI core make before anything is clocked.
+    std::size_t tx_total = 0;
+    std::size_t rx_total = 0;
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        const spi_ioc_transfer& op = ops[idx];
+        const uint8_t bits = op.bits_per_word ? op.bits_per_word : bits_per_word_;
+        if (bits > 32 || op.len % bytesPerWord(bits) != 0) {
+            return reject(EINVAL);
+        }
+        tx_total += op.tx_buf ? op.len : 0;
+        rx_total += op.rx_buf ? op.len : 0;
+        if (tx_total > options_.bufsiz || rx_total > options_.bufsiz) {
+            return reject(EMSGSIZE);
+        }
+    }
+
+    uint64_t now = now_ns_;
+    if (options_.timing == Timing::Paced) {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch_);
+        now = std::max<uint64_t>(now, static_cast<uint64_t>(elapsed.count()));
+    }
+    const uint64_t started = now;
+    now += static_cast<uint64_t>(options_.message_setup.count());
+    setChipSelect(true, now);
+
+    std::size_t clocked = 0;
+    for (std::size_t idx = 0; idx < count; ++idx) {
+        const spi_ioc_transfer& op = ops[idx];
+        const std::size_t length = op.len;
+        const uint8_t bits = op.bits_per_word ? op.bits_per_word : bits_per_word_;
+        const uint32_t speed = std::min(op.speed_hz ? op.speed_hz : max_speed_hz_, options_.controller_max_hz);
+        const double ns_per_byte = static_cast<double>(bits) / static_cast<double>(bytesPerWord(bits)) * 1e9 /
+                                   static_cast<double>(speed);
+
+        if (length > 0) {
+            const auto* tx = reinterpret_cast<const uint8_t*>(op.tx_buf);
+            auto* rx = reinterpret_cast<uint8_t*>(op.rx_buf);
+            if (!tx) {
+                mosi_scratch_.assign(length, 0x00);
+                tx = mosi_scratch_.data();
+            } else if (rx && overlaps(tx, rx, length)) {
+                mosi_scratch_.assign(tx, tx + length);
+                tx = mosi_scratch_.data();
+            }
+            uint8_t* miso = rx;
+            if (!miso) {
+                miso_scratch_.resize(length);
+                miso = miso_scratch_.data();
+            }
+            if (peer_) {
+                peer_->clock(tx, miso, length, now, ns_per_byte);
+            } else {
+                std::memset(miso, 0xFF, length);
+            }
+        }
+
+        now += static_cast<uint64_t>(std::llround(static_cast<double>(length) * ns_per_byte));
+        now += static_cast<uint64_t>(op.delay_usecs) * 1000;
+        clocked += length;
+        ++stats_.transfers;
+        stats_.bytes += length;
+
+        if (op.cs_change && idx + 1 < count) {
+            setChipSelect(false, now);
+            now += static_cast<uint64_t>(options_.cs_inactive.count());
+            setChipSelect(true, now);
+            ++stats_.cs_toggles;
+        }
+    }
+    // cs_change on the last transfer means "leave CS asserted".
+    if (!ops[count - 1].cs_change) {
+        setChipSelect(false, now);
+    }
+
+    ++stats_.messages;
+    stats_.bus_time_ns += now - started;
+    now_ns_ = now;
+
+    if (options_.timing == Timing::Paced) {
+        const Clock::time_point deadline = epoch_ + std::chrono::nanoseconds(now);
+        if (deadline - Clock::now() > kSpinWindow) {
+            std::this_thread::sleep_until(deadline - kSpinWindow);
+        }
+        while (Clock::now() < deadline) {
+        }
+    }
+    return static_cast<int>(clocked);
+}
+
+int SimulatedSpiDevice::writeMode(uint8_t mode) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    mode_ = mode;
+    return 0;
+}
+
+int SimulatedSpiDevice::writeBitsPerWord(uint8_t bits) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (bits > 32) {
+        errno = EINVAL;
+        return -1;
+    }
+    bits_per_word_ = bits ? bits : 8;
+    return 0;
+}
+
+int SimulatedSpiDevice::writeMaxSpeed(uint32_t hz) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_speed_hz_ = hz ? hz : options_.controller_max_hz;
+    return 0;
+}
+
+uint64_t SimulatedSpiDevice::nowNs() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return now_ns_;
+}
+
+SimulatedSpiDevice::Stats SimulatedSpiDevice::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+uint8_t SimulatedSpiDevice::mode() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return mode_;
+}
+
+uint8_t SimulatedSpiDevice::bitsPerWord() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bits_per_word_;
+}
+
+uint32_t SimulatedSpiDevice::maxSpeed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_speed_hz_;
+}
+
+} // namespace spi_eak
@@ -0,0 +1,223 @@
+#ifndef SIM_SPI_H
+#define SIM_SPI_H
+
+#include "spi_transport.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace spi_eak {
+
+/**
+ * The device on the far side of a SimulatedSpiDevice. clock() is called
+ * once per transfer with the bytes the host shifts out; the peer fills
+ * `miso` with what it shifts back. Byte i of the transfer is clocked at
+ * start_ns + i * ns_per_byte on the simulated clock.
+ */
+class SimPeer {
+public:
+    virtual ~SimPeer() = default;
+
+    /**
+     * `mosi` is all zeros for RX-only transfers; `miso` is always writable.
+     */
+    virtual void clock(const uint8_t* mosi, uint8_t* miso, std::size_t length,
+                       uint64_t start_ns, double ns_per_byte) = 0;
+
+    /**
+     * Chip select edges, for peers that frame on CS.
+     */
+    virtual void chipSelect(bool /*asserted*/, uint64_t /*now_ns*/) {}
+};
+
+/**
+ * MISO wired to MOSI: every transfer reads back what it sent.
+ */
+class LoopbackPeer : public SimPeer {
+public:
+    void clock(const uint8_t* mosi, uint8_t* miso, std::size_t length,
+               uint64_t start_ns, double ns_per_byte) override;
+};
+
+/**
+ * Shifts back everything it received once `latency` has passed on the
+ * simulated clock, like a device answering from a FIFO. Until a byte is
+ * due it clocks out fill_byte. A byte is never echoed within the clock it
+ * arrived on, so the minimum lag is one byte.
+ */
+class EchoPeer : public SimPeer {
+public:
+    explicit EchoPeer(std::chrono::nanoseconds latency = std::chrono::nanoseconds{0}, uint8_t fill_byte = 0x00);
+
+    void clock(const uint8_t* mosi, uint8_t* miso, std::size_t length,
+               uint64_t start_ns, double ns_per_byte) override;
+
+private:
+    uint64_t latency_ns_;
+    uint8_t fill_byte_;
+    std::deque<std::pair<uint64_t, uint8_t>> pending_; // (due time, byte)
+};
+
+/**
+ * Wraps another peer and flips bits independently in both directions: on
+ * MOSI before the inner peer sees it, and on MISO before the host does.
+ * The rate is fixed, or a RateModel of the clock rate of each transfer, so
+ * a link can be made to fail above some speed.
+ */
+class BitErrorPeer : public SimPeer {
+public:
+    /**
+     * Bit error rate for a transfer clocked at `clock_hz`.
+     */
+    using RateModel = std::function<double(double clock_hz)>;
+
+    BitErrorPeer(std::shared_ptr<SimPeer> inner, double bit_error_rate, uint32_t seed = 1);
+    BitErrorPeer(std::shared_ptr<SimPeer> inner, RateModel model, uint32_t seed = 1);
+
+    /**
+     * A marginal link: `ber_at_knee` at `knee_hz`, growing tenfold every
+     * `hz_per_decade` above it and shrinking likewise below, capped at 0.5.
+     */
+    static RateModel kneeModel(double knee_hz, double ber_at_knee, double hz_per_decade);
+
+    void clock(const uint8_t* mosi, uint8_t* miso, std::size_t length,
+               uint64_t start_ns, double ns_per_byte) override;
+    void chipSelect(bool asserted, uint64_t now_ns) override;
+
+    [[nodiscard]] uint64_t bitsFlipped() const noexcept { return bits_flipped_; }
+
+private:
+    void setRate(double bit_error_rate);
+    void corrupt(uint8_t* data, std::size_t length);
+
+    std::shared_ptr<SimPeer> inner_;
+    RateModel model_;
+    double bit_error_rate_ = 0.0;
+    std::mt19937 rng_;
+    std::geometric_distribution<uint64_t> gap_;
+    uint64_t bits_to_next_error_ = 0;
+    uint64_t bits_flipped_ = 0;
+    std::vector<uint8_t> mosi_;
+};
+
+/**
+ * A peer defined by a callable, for one-off behaviour in tests.
+ */
+class ScriptedPeer : public SimPeer {
+public:
+    using Script = std::function<void(const uint8_t* mosi, uint8_t* miso, std::size_t length,
+                                      uint64_t start_ns, double ns_per_byte)>;
+
+    explicit ScriptedPeer(Script script);
+
+    void clock(const uint8_t* mosi, uint8_t* miso, std::size_t length,
+               uint64_t start_ns, double ns_per_byte) override;
+
+private:
+    Script script_;
+};
+
+/**
+ * In-process stand-in for a spidev node, for running SPI and everything
+ * built on it without hardware:
+ *
+ *     auto device = std::make_shared<SimulatedSpiDevice>(options, std::make_shared<EchoPeer>());
+ *     SPI spi(device, SPI::Config{"sim", 8'000'000});
+ *
+ * Messages are checked the way spidev checks them (per-direction bufsiz
+ * limit, bits per word, whole words per transfer) and fail with the same
+ * errno. Each message is charged message_setup, then every transfer its
+ * clocking time at the effective speed (transfer speed_hz, else the device
+ * max, capped by controller_max_hz), its delay_usecs, and cs_inactive for
+ * every CS toggle requested by cs_change. CS stays asserted across
+ * messages when the last transfer sets cs_change, as in spidev.
+ *
+ * With Timing::Virtual only the simulated clock advances, so results are
+ * deterministic and as fast as the CPU allows. Timing::Paced also holds
+ * each message() until the modelled duration has passed on the steady
+ * clock, so wall-clock measurements include the bus. Calls are serialised
+ * by an internal mutex, so several threads may share one device; SPI
+ * handles that need different settings should share it through a
+ * SpiDeviceSession.
+ */
+class SimulatedSpiDevice : public SpiTransport {
+public:
+    enum class Timing {
+        Virtual,
+        Paced
+    };
+
+    struct Options {
+        std::size_t bufsiz = 4096;                          // per-direction message limit, like spidev's
+        uint32_t controller_max_hz = 50'000'000;
+        std::chrono::nanoseconds message_setup{20'000};    // syscall, queueing and DMA setup per ioctl
+        std::chrono::nanoseconds cs_inactive{1'000};       // CS high time for each cs_change toggle
+        Timing timing = Timing::Virtual;
+    };
+
+    struct Stats {
+        uint64_t messages = 0;
+        uint64_t transfers = 0;
+        uint64_t bytes = 0;            // bytes clocked; a full-duplex byte counts once
+        uint64_t cs_toggles = 0;
+        uint64_t rejected = 0;         // messages refused before clocking
+        uint64_t bus_time_ns = 0;      // modelled time spent in messages
+    };
+
+    SimulatedSpiDevice();
+    explicit SimulatedSpiDevice(const Options& options, std::shared_ptr<SimPeer> peer = nullptr);
+
+    /**
+     * Replace the peer; null leaves MISO at 0xFF, like an undriven line
+     * with a pull-up.
+     */
+    void setPeer(std::shared_ptr<SimPeer> peer);
+
+    int message(spi_ioc_transfer* ops, std::size_t count) override;
+    int writeMode(uint8_t mode) override;
+    int writeBitsPerWord(uint8_t bits) override;
+    int writeMaxSpeed(uint32_t hz) override;
+    [[nodiscard]] std::size_t bufferSize() const override { return options_.bufsiz; }
+
+    /**
+     * Simulated clock in ns since construction, as of the end of the last
+     * message.
+     */
+    [[nodiscard]] uint64_t nowNs() const;
+    [[nodiscard]] Stats stats() const;
+    [[nodiscard]] uint8_t mode() const;
+    [[nodiscard]] uint8_t bitsPerWord() const;
+    [[nodiscard]] uint32_t maxSpeed() const;
+    [[nodiscard]] const Options& options() const noexcept { return options_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    int reject(int err);
+    void setChipSelect(bool asserted, uint64_t now_ns);
+
+    const Options options_;
+    mutable std::mutex mutex_;
+    std::shared_ptr<SimPeer> peer_;
+    uint8_t mode_ = 0;
+    uint8_t bits_per_word_ = 8;
+    uint32_t max_speed_hz_ = 0;
+    bool cs_asserted_ = false;
+    uint64_t now_ns_ = 0;
+    Clock::time_point epoch_;
+    Stats stats_;
+    std::vector<uint8_t> mosi_scratch_;
+    std::vector<uint8_t> miso_scratch_;
+};
+
+} // namespace spi_eak
+
+#endif // SIM_SPI_H
@@ -1,17 +1,21 @@
 #include "spi.h"
+#include "capture.h"
+#include "spi_transport.h"
+#include "sys_util.h"
 
 #ifndef __linux__
 #error "SPI-EAK currently requires Linux with spidev support"
 #endif
 
-#include <fcntl.h>
-#include <unistd.h>
 #include <sys/ioctl.h>
 #include <linux/spi/spidev.h>
 #include <cstring>
+#include <algorithm>
+#include <atomic>
 #include <cerrno>
+#include <chrono>
+#include <fstream>
 #include <limits>
-#include <system_error>
 #include <utility>
 #include <vector>
 
@@ -19,49 +23,103 @@ namespace spi_eak {
 
 namespace {
 
-std::string errnoMessage(int err) {
-    return std::error_code(err, std::generic_category()).message();
+constexpr uint32_t kMaxTransferLen = std::numeric_limits<uint32_t>::max();
+
+// SPI_IOC_MESSAGE(n) encodes n * sizeof(spi_ioc_transfer) in the ioctl size field.
+constexpr size_t kMaxSegmentsPerMessage = ((1u << _IOC_SIZEBITS) - 1) / sizeof(spi_ioc_transfer);
+
+constexpr size_t kDefaultSpidevBufsiz = 4096;
+constexpr const char* kSpidevBufsizPath = "/sys/module/spidev/parameters/bufsiz";
+
+// Generations come from one counter so that no two handles ever share one:
+// a plan compiled on a handle that is later move-assigned over (same
+// address) must still see a changed generation.
+std::atomic<uint64_t> g_config_generation{0};
+
+uint64_t nextConfigGeneration() {
+    return g_config_generation.fetch_add(1, std::memory_order_relaxed) + 1;
 }
 
-constexpr uint32_t kMaxTransferLen = std::numeric_limits<uint32_t>::max();
+void validateSegment(const SPI::Segment& seg) {
+    if (seg.length == 0) {
+        throw std::invalid_argument("Segment length must be non-zero");
+    }
+    if (seg.length > kMaxTransferLen) {
+        throw std::invalid_argument("Segment length exceeds 32-bit ioctl limit");
+    }
+    if (!seg.tx_buffer && !seg.rx_buffer) {
+        throw std::invalid_argument("At least one buffer pointer must be provided for SPI segment");
+    }
+}
 
 } // namespace
 
+SPI::TransferPlan::TransferPlan() = default;
+SPI::TransferPlan::~TransferPlan() = default;
+SPI::TransferPlan::TransferPlan(TransferPlan&& other) noexcept = default;
+SPI::TransferPlan& SPI::TransferPlan::operator=(TransferPlan&& other) noexcept = default;
+
+void SPI::TransferPlan::setBuffers(std::size_t index, const uint8_t* tx, uint8_t* rx) {
+    if (index >= segments_.size()) {
+        throw std::out_of_range("TransferPlan segment index out of range");
+    }
+    if (!tx && !rx) {
+        throw std::invalid_argument("At least one buffer pointer must be provided for SPI segment");
+    }
+    segments_[index].tx_buffer = tx;
+    segments_[index].rx_buffer = rx;
+    ops_[index].tx_buf = reinterpret_cast<__u64>(tx);
+    ops_[index].rx_buf = reinterpret_cast<__u64>(rx);
+}
+
+void SPI::TransferPlan::setLength(std::size_t index, std::size_t length) {
+    if (index >= segments_.size()) {
+        throw std::out_of_range("TransferPlan segment index out of range");
+    }
+    if (length == 0) {
+        throw std::invalid_argument("Segment length must be non-zero");
+    }
+    if (length > kMaxTransferLen) {
+        throw std::invalid_argument("Segment length exceeds 32-bit ioctl limit");
+    }
+    segments_[index].length = length;
+    ops_[index].len = static_cast<__u32>(length);
+}
+
 SPI::SPI(const std::string& device, uint32_t speed, Mode mode, uint8_t bits)
     : SPI(Config{device, speed, mode, bits}) {}
 
 SPI::SPI(const Config& config)
-    : fd(-1)
+    : SPI(std::make_shared<SpidevTransport>(config.device), config) {}
+
+SPI::SPI(std::shared_ptr<SpiTransport> transport, const Config& config)
+    : transport_(std::move(transport))
     , config_(config)
+    , config_generation_(nextConfigGeneration())
 {
-    fd = ::open(config_.device.c_str(), O_RDWR);
-    if (fd < 0) {
-        const int err = errno;
-        throw std::runtime_error("Failed to open SPI device '" + config_.device + "': " + errnoMessage(err));
-    }
-
-    try {
-        configureDevice();
-        config_dirty_ = false;
-    } catch (...) {
-        ::close(fd);
-        fd = -1;
-        throw;
+    if (!transport_) {
+        throw std::invalid_argument("SPI transport must not be null");
     }
+    configureDevice();
+    config_dirty_ = false;
 }
 
 SPI::~SPI() {
     close();
 }
 
-// Move constructor: "steals" the file descriptor from the other object
+// Move constructor: "steals" the transport from the other object
 SPI::SPI(SPI&& other) noexcept
-    : fd(other.fd)
+    : transport_(std::move(other.transport_))
     , config_(std::move(other.config_))
     , config_dirty_(other.config_dirty_)
+    , config_generation_(other.config_generation_)
+    , metrics_(other.metrics_)
+    , ops_scratch_(std::move(other.ops_scratch_))
+    , capture_(other.capture_)
+    , capture_channel_(other.capture_channel_)
 {
     // Invalidate the other object so its destructor does nothing
-    other.fd = -1;
     other.config_dirty_ = false;
 }
 
@@ -71,26 +129,27 @@ SPI& SPI::operator=(SPI&& other) noexcept {
         close(); // Close our own resource first
 
         // Steal resources from the other object
-        fd = other.fd;
+        transport_ = std::move(other.transport_);
         config_ = std::move(other.config_);
         config_dirty_ = other.config_dirty_;
+        config_generation_ = other.config_generation_;
+        metrics_ = other.metrics_;
+        ops_scratch_ = std::move(other.ops_scratch_);
+        capture_ = other.capture_;
+        capture_channel_ = other.capture_channel_;
 
         // Invalidate the other object
-        other.fd = -1;
         other.config_dirty_ = false;
     }
     return *this;
 }
 
 void SPI::close() {
-    if (fd >= 0) {
-        ::close(fd);
-        fd = -1;
-    }
+    transport_.reset();
 }
 
 bool SPI::isOpen() const {
-    return fd >= 0;
+    return transport_ != nullptr;
 }
 
 // C++ vector-based transfer (wrapper)
@@ -102,7 +161,7 @@ std::vector<uint8_t> SPI::transfer(const std::vector<uint8_t>& tx_data) {
 
 // C-style raw pointer transfer (core logic)
 void SPI::transfer(uint8_t* rx_data, const uint8_t* tx_data, size_t length) {
-    if (fd < 0) {
+    if (!transport_) {
         throw std::logic_error("SPI device is not open (was it moved from?)");
     }
     if (!tx_data || !rx_data) {
@@ -125,35 +184,31 @@ void SPI::transfer(uint8_t* rx_data, const uint8_t* tx_data, size_t length) {
     transfer_desc.delay_usecs = config_.delay_usecs;
     transfer_desc.cs_change = config_.cs_change;
     
-    if (ioctl(fd, SPI_IOC_MESSAGE(1), &transfer_desc) < 0) {
+    if (sendMessage(&transfer_desc, 1) < 0) {
         const int err = errno;
-        throw std::runtime_error("SPI transfer failed: " + errnoMessage(err));
+        throw std::runtime_error("SPI transfer failed: " + detail::errnoMessage(err));
     }
 }
 
 void SPI::transfer(const std::vector<Segment>& segments) {
-    if (fd < 0) {
+    if (!transport_) {
         throw std::logic_error("SPI device is not open (was it moved from?)");
     }
     if (segments.empty()) {
         return;
     }
+    if (segments.size() > kMaxSegmentsPerMessage) {
+        throw std::invalid_argument("Too many segments for a single SPI message");
+    }
 
     ensureConfigured();
 
-    std::vector<spi_ioc_transfer> ops(segments.size());
+    auto& ops = ops_scratch_;
+    ops.resize(segments.size());
     bool segment_sets_cs_change = false;
     for (size_t i = 0; i < segments.size(); ++i) {
         const auto& seg = segments[i];
-        if (seg.length == 0) {
-            throw std::invalid_argument("Segment length must be non-zero");
-        }
-        if (seg.length > kMaxTransferLen) {
-            throw std::invalid_argument("Segment length exceeds 32-bit ioctl limit");
-        }
-        if (!seg.tx_buffer && !seg.rx_buffer) {
-            throw std::invalid_argument("At least one buffer pointer must be provided for SPI segment");
-        }
+        validateSegment(seg);
 
         auto& op = ops[i];
         memset(&op, 0, sizeof(op));
@@ -172,25 +227,205 @@ void SPI::transfer(const std::vector<Segment>& segments) {
         ops.back().cs_change = 1;
     }
 
-    if (ioctl(fd, SPI_IOC_MESSAGE(ops.size()), ops.data()) < 0) {
+    if (sendMessage(ops.data(), ops.size()) < 0) {
         const int err = errno;
-        throw std::runtime_error("SPI multi-segment transfer failed: " + errnoMessage(err));
+        throw std::runtime_error("SPI multi-segment transfer failed: " + detail::errnoMessage(err));
+    }
+}
+
+size_t SPI::maxSegmentsPerMessage() noexcept {
+    return kMaxSegmentsPerMessage;
+}
+
+size_t SPI::driverBufferSize() {
+    static const size_t bufsiz = []() {
+        std::ifstream param(kSpidevBufsizPath);
+        size_t value = 0;
+        if (param >> value && value > 0) {
+            return value;
+        }
+        return kDefaultSpidevBufsiz;
+    }();
+    return bufsiz;
+}
+
+size_t SPI::messageLimit() const {
+    if (!transport_) {
+        throw std::logic_error("SPI device is not open (was it moved from?)");
     }
+    return transport_->bufferSize();
+}
+
+void SPI::transferChunked(uint8_t* rx_data, const uint8_t* tx_data, size_t length,
+                          const ChunkOptions& options) {
+    if (!transport_) {
+        throw std::logic_error("SPI device is not open (was it moved from?)");
+    }
+    if (!tx_data && !rx_data) {
+        throw std::invalid_argument("Invalid buffer pointer provided to SPI transfer");
+    }
+    if (length == 0) {
+        return;
+    }
+
+    const size_t message_limit = std::min<size_t>(messageLimit(), kMaxTransferLen);
+    const size_t chunk = options.chunk_bytes ? std::min(options.chunk_bytes, message_limit)
+                                             : message_limit;
+    const size_t chunks_total = (length + chunk - 1) / chunk;
+    const size_t per_message = std::min({message_limit / chunk, kMaxSegmentsPerMessage, chunks_total});
+
+    ensureConfigured();
+
+    // spidev semantics: cs_change on an inner transfer toggles CS before the
+    // next one; on the last transfer it leaves CS asserted after the message.
+    auto& ops = ops_scratch_;
+    ops.resize(per_message);
+    size_t offset = 0;
+    while (offset < length) {
+        size_t count = 0;
+        do {
+            const size_t len = std::min(chunk, length - offset);
+            auto& op = ops[count];
+            memset(&op, 0, sizeof(op));
+            op.tx_buf = tx_data ? reinterpret_cast<__u64>(tx_data + offset) : 0;
+            op.rx_buf = rx_data ? reinterpret_cast<__u64>(rx_data + offset) : 0;
+            op.len = static_cast<__u32>(len);
+            op.speed_hz = config_.speed_hz;
+            op.bits_per_word = config_.bits_per_word;
+            op.delay_usecs = config_.delay_usecs;
+            op.cs_change = options.hold_cs ? 0 : 1;
+            offset += len;
+            ++count;
+        } while (count < per_message && offset < length);
+
+        auto& last = ops[count - 1];
+        if (offset < length) {
+            last.cs_change = options.hold_cs ? 1 : 0;
+        } else {
+            last.cs_change = (options.leave_cs_asserted || config_.cs_change) ? 1 : 0;
+        }
+
+        if (sendMessage(ops.data(), count) < 0) {
+            const int err = errno;
+            throw std::runtime_error("SPI chunked transfer failed at offset " +
+                                     std::to_string(offset) + ": " + detail::errnoMessage(err));
+        }
+    }
+}
+
+SPI::TransferPlan SPI::compile(const std::vector<Segment>& segments) const {
+    if (segments.empty()) {
+        throw std::invalid_argument("TransferPlan needs at least one segment");
+    }
+    if (segments.size() > kMaxSegmentsPerMessage) {
+        throw std::invalid_argument("Too many segments for a single SPI message");
+    }
+
+    TransferPlan plan;
+    plan.segments_ = segments;
+    plan.ops_.resize(segments.size());
+    for (size_t i = 0; i < segments.size(); ++i) {
+        const auto& seg = segments[i];
+        validateSegment(seg);
+
+        auto& op = plan.ops_[i];
+        memset(&op, 0, sizeof(op));
+        op.tx_buf = reinterpret_cast<__u64>(seg.tx_buffer);
+        op.rx_buf = reinterpret_cast<__u64>(seg.rx_buffer);
+        op.len = static_cast<__u32>(seg.length);
+    }
+    applyDefaults(plan);
+    return plan;
+}
+
+void SPI::execute(TransferPlan& plan) {
+    if (!transport_) {
+        throw std::logic_error("SPI device is not open (was it moved from?)");
+    }
+    if (plan.ops_.empty()) {
+        throw std::invalid_argument("TransferPlan is empty (was it moved from?)");
+    }
+
+    ensureConfigured();
+    if (plan.bound_to_ != this || plan.config_generation_ != config_generation_) {
+        applyDefaults(plan);
+    }
+
+    if (sendMessage(plan.ops_.data(), plan.ops_.size()) < 0) {
+        const int err = errno;
+        throw std::runtime_error("SPI plan transfer failed: " + detail::errnoMessage(err));
+    }
+}
+
+// Fill the per-transfer fields that fall back to the device config.
+void SPI::applyDefaults(TransferPlan& plan) const {
+    bool segment_sets_cs_change = false;
+    for (size_t i = 0; i < plan.segments_.size(); ++i) {
+        const auto& seg = plan.segments_[i];
+        auto& op = plan.ops_[i];
+        op.speed_hz = seg.speed_override_hz ? seg.speed_override_hz : config_.speed_hz;
+        op.bits_per_word = seg.bits_override ? seg.bits_override : config_.bits_per_word;
+        op.delay_usecs = seg.delay_override_usecs ? seg.delay_override_usecs : config_.delay_usecs;
+        op.cs_change = seg.cs_change;
+        segment_sets_cs_change = segment_sets_cs_change || seg.cs_change;
+    }
+    if (config_.cs_change && !segment_sets_cs_change) {
+        plan.ops_.back().cs_change = 1;
+    }
+    plan.bound_to_ = this;
+    plan.config_generation_ = config_generation_;
+}
+
+int SPI::sendMessage(spi_ioc_transfer* ops, size_t count) {
+    if (!metrics_ && !capture_) {
+        return transport_->message(ops, count);
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    const int rc = transport_->message(ops, count);
+    const int err = errno;
+    if (metrics_) {
+        metrics_->ioctl_latency.record(std::chrono::steady_clock::now() - started);
+        detail::bump(metrics_->messages);
+        if (rc < 0) {
+            detail::bump(metrics_->errors);
+        } else {
+            uint64_t bytes = 0;
+            for (size_t i = 0; i < count; ++i) {
+                bytes += ops[i].len;
+            }
+            detail::bump(metrics_->bytes_clocked, bytes);
+        }
+    }
+    if (capture_ && rc >= 0) {
+        for (size_t i = 0; i < count; ++i) {
+            capture_->record(reinterpret_cast<const uint8_t*>(ops[i].tx_buf),
+                             reinterpret_cast<const uint8_t*>(ops[i].rx_buf),
+                             ops[i].len, capture_channel_);
+        }
+    }
+    errno = err;
+    return rc;
+}
+
+void SPI::markConfigChanged() {
+    config_dirty_ = true;
+    config_generation_ = nextConfigGeneration();
 }
 
 void SPI::setSpeed(uint32_t hz) {
     config_.speed_hz = hz;
-    config_dirty_ = true;
+    markConfigChanged();
 }
 
 void SPI::setMode(Mode new_mode) {
     config_.mode = new_mode;
-    config_dirty_ = true;
+    markConfigChanged();
 }
 
 void SPI::setBitsPerWord(uint8_t bits) {
     config_.bits_per_word = bits;
-    config_dirty_ = true;
+    markConfigChanged();
 }
 
 uint32_t SPI::getSpeed() const {
@@ -208,12 +443,12 @@ uint8_t SPI::getBitsPerWord() const {
 void SPI::reconfigure(const Config& config) {
     const Config previous = config_;
     config_ = config;
-    config_dirty_ = true;
+    markConfigChanged();
     try {
         configureDevice();
     } catch (...) {
         config_ = previous;
-        config_dirty_ = true;
+        markConfigChanged();
         throw;
     }
 }
@@ -222,29 +457,35 @@ void SPI::applyConfig() {
     ensureConfigured();
 }
 
+// Always writes all three settings: spidev keeps them per device node, so
+// another handle on the same node may have changed any of them since this
+// one last wrote. Sharing one fd with diffed writes is SpiDeviceSession's job.
 void SPI::configureDevice() {
-    if (fd < 0) {
+    if (!transport_) {
         throw std::logic_error("Cannot configure SPI device before opening");
     }
+    if (metrics_) {
+        detail::bump(metrics_->reconfigurations);
+        detail::bump(metrics_->config_ioctls, 3);
+    }
 
-    uint8_t raw_mode = static_cast<uint8_t>(config_.mode);
-    if (ioctl(fd, SPI_IOC_WR_MODE, &raw_mode) < 0) {
+    if (transport_->writeMode(static_cast<uint8_t>(config_.mode)) < 0) {
         const int err = errno;
-        throw std::runtime_error("Failed to set SPI mode: " + errnoMessage(err));
+        throw std::runtime_error("Failed to set SPI mode: " + detail::errnoMessage(err));
     }
-    if (ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &config_.bits_per_word) < 0) {
+    if (transport_->writeBitsPerWord(config_.bits_per_word) < 0) {
         const int err = errno;
-        throw std::runtime_error("Failed to set bits per word: " + errnoMessage(err));
+        throw std::runtime_error("Failed to set bits per word: " + detail::errnoMessage(err));
     }
-    if (ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &config_.speed_hz) < 0) {
+    if (transport_->writeMaxSpeed(config_.speed_hz) < 0) {
         const int err = errno;
-        throw std::runtime_error("Failed to set max speed: " + errnoMessage(err));
+        throw std::runtime_error("Failed to set max speed: " + detail::errnoMessage(err));
     }
     config_dirty_ = false;
 }
 
 void SPI::ensureConfigured() {
-    if (fd < 0) {
+    if (!transport_) {
         throw std::logic_error("SPI device is not open (was it moved from?)");
     }
     if (!config_dirty_) {
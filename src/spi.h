@@ -3,12 +3,20 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 #include <stdexcept>
 
+#include "metrics.h"
+
+struct spi_ioc_transfer;
+
 namespace spi_eak {
 
+class CaptureWriter;
+class SpiTransport;
+
 class SPI {
 public:
     // SPI modes (CPOL | CPHA)
@@ -28,6 +36,12 @@ public:
         bool cs_change = false;
     };
 
+    struct ChunkOptions {
+        size_t chunk_bytes = 0;          // 0 -> spidev buffer limit
+        bool hold_cs = true;             // keep CS asserted across chunk and message boundaries
+        bool leave_cs_asserted = false;  // keep CS asserted after the final chunk (streaming)
+    };
+
     struct Segment {
         const uint8_t* tx_buffer = nullptr;
         uint8_t* rx_buffer = nullptr;
@@ -38,6 +52,45 @@ public:
         bool cs_change = false;
     };
 
+    /**
+     * A multi-segment message validated and laid out once by compile(), then
+     * sent repeatedly with execute(). Only buffer pointers and lengths are
+     * meant to change between cycles; executing a plan is one ioctl with no
+     * allocation. Segments that rely on the device defaults (zero overrides)
+     * pick up config changes automatically on the next execute().
+     */
+    class TransferPlan {
+    public:
+        TransferPlan();
+        ~TransferPlan();
+        TransferPlan(TransferPlan&& other) noexcept;
+        TransferPlan& operator=(TransferPlan&& other) noexcept;
+        TransferPlan(const TransferPlan&) = delete;
+        TransferPlan& operator=(const TransferPlan&) = delete;
+
+        [[nodiscard]] std::size_t size() const noexcept { return segments_.size(); }
+        [[nodiscard]] const Segment& segment(std::size_t index) const { return segments_.at(index); }
+
+        /**
+         * Repoint segment `index`. At least one of tx/rx must be non-null.
+         */
+        void setBuffers(std::size_t index, const uint8_t* tx, uint8_t* rx);
+
+        /**
+         * Change the length of segment `index`; must be non-zero and fit the
+         * 32-bit ioctl field.
+         */
+        void setLength(std::size_t index, std::size_t length);
+
+    private:
+        friend class SPI;
+
+        std::vector<Segment> segments_;
+        std::vector<spi_ioc_transfer> ops_;
+        const SPI* bound_to_ = nullptr;
+        uint64_t config_generation_ = 0;
+    };
+
     /**
      * Constructor that acquires and configures the SPI device.
      * Throws std::runtime_error on failure.
@@ -48,6 +101,14 @@ public:
      */
     SPI(const std::string& device, uint32_t speed, Mode mode = Mode::MODE_0, uint8_t bits_per_word = 8);
     explicit SPI(const Config& config);
+
+    /**
+     * Drive `transport` instead of opening config.device (which is kept only
+     * as a label), e.g. a SimulatedSpiDevice. The transport is configured
+     * immediately. Throws std::invalid_argument for a null transport and
+     * std::runtime_error when configuration fails.
+     */
+    SPI(std::shared_ptr<SpiTransport> transport, const Config& config);
     
     /**
      * Destructor - automatically closes the SPI device.
@@ -78,12 +139,73 @@ public:
      */
     void transfer(uint8_t* rx_data, const uint8_t* tx_data, size_t length);
 
+    /**
+     * Transfer tx_data into rx_data, resized to match. Unlike the returning
+     * overload this reuses rx_data's storage, so with an ArenaVector (or a
+     * vector reserved up front) the call does not allocate.
+     * @throws std::runtime_error on transfer failure.
+     */
+    template <typename Allocator>
+    void transfer(const std::vector<uint8_t, Allocator>& tx_data, std::vector<uint8_t, Allocator>& rx_data) {
+        rx_data.resize(tx_data.size());
+        transfer(rx_data.data(), tx_data.data(), tx_data.size());
+    }
+
     /**
      * Transfer multiple segments in a single CS assertion.
      * Allows callers to send headers + payloads without round-trips.
+     * The descriptor array is kept between calls, so once it has grown to
+     * the largest segment count in use this does not allocate.
+     * @throws std::invalid_argument for an invalid segment or more than
+     *         maxSegmentsPerMessage() segments.
      */
     void transfer(const std::vector<Segment>& segments);
 
+    /**
+     * Transfer a buffer of any size by splitting it into chunks that respect
+     * the transport's buffer limit (see messageLimit()). Chunks are packed into
+     * as few SPI_IOC_MESSAGE calls as the limit allows. Either buffer may be
+     * null for half-duplex use.
+     * Holding CS across ioctls only works while no other device on the same
+     * controller is addressed in between.
+     * @throws std::runtime_error on transfer failure.
+     */
+    void transferChunked(uint8_t* rx_data, const uint8_t* tx_data, size_t length,
+                         const ChunkOptions& options);
+    void transferChunked(uint8_t* rx_data, const uint8_t* tx_data, size_t length) {
+        transferChunked(rx_data, tx_data, length, ChunkOptions{});
+    }
+
+    /**
+     * Largest message spidev accepts in one ioctl, read once from
+     * /sys/module/spidev/parameters/bufsiz (4096 when unavailable).
+     */
+    [[nodiscard]] static size_t driverBufferSize();
+
+    /**
+     * Most segments one SPI_IOC_MESSAGE can carry; the ioctl encodes the
+     * descriptor array size in a 14-bit field.
+     */
+    [[nodiscard]] static size_t maxSegmentsPerMessage() noexcept;
+
+    /**
+     * Largest message this handle's transport accepts: driverBufferSize()
+     * for spidev, the modelled limit for a simulated device.
+     */
+    [[nodiscard]] size_t messageLimit() const;
+
+    /**
+     * Validate `segments` and lay out their ioctl descriptors once.
+     * Throws std::invalid_argument on the same conditions as transfer().
+     */
+    [[nodiscard]] TransferPlan compile(const std::vector<Segment>& segments) const;
+
+    /**
+     * Send a compiled plan as a single SPI_IOC_MESSAGE.
+     * @throws std::runtime_error on transfer failure.
+     */
+    void execute(TransferPlan& plan);
+
     /**
      * Check if the device handle is valid.
      * @return true if the handle is valid, false otherwise (e.g., after being moved from).
@@ -102,14 +224,39 @@ public:
     void applyConfig();
     [[nodiscard]] const Config& currentConfig() const noexcept { return config_; }
 
+    /**
+     * Record ioctl latency, byte and reconfiguration counters into `metrics`
+     * (nullptr detaches). The metrics object must outlive the attachment;
+     * without one the transfer path pays a single pointer test.
+     */
+    void attachMetrics(SpiMetrics* metrics) noexcept { metrics_ = metrics; }
+
+    /**
+     * Append every completed transfer (TX and RX bytes, timestamped and
+     * tagged with `channel`) to `writer` (nullptr detaches). The writer must
+     * outlive the attachment.
+     */
+    void attachCapture(CaptureWriter* writer, uint16_t channel = 0) noexcept {
+        capture_ = writer;
+        capture_channel_ = channel;
+    }
+
 private:
     void close(); // Private helper for RAII
     void configureDevice();
     void ensureConfigured();
+    void markConfigChanged();
+    int sendMessage(spi_ioc_transfer* ops, size_t count);
+    void applyDefaults(TransferPlan& plan) const;
 
-    int fd; // File descriptor for the device
+    std::shared_ptr<SpiTransport> transport_; // null once closed or moved from
     Config config_;
     bool config_dirty_ = false;
+    uint64_t config_generation_ = 0; // process-unique, renewed on every config edit; lets plans refresh lazily
+    SpiMetrics* metrics_ = nullptr;
+    std::vector<spi_ioc_transfer> ops_scratch_; // reused by transfer(segments) and transferChunked()
+    CaptureWriter* capture_ = nullptr;
+    uint16_t capture_channel_ = 0;
 };
 
 } // namespace spi_eak
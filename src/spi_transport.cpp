@@ -0,0 +1,48 @@
+#include "spi_transport.h"
+#include "spi.h"
+#include "sys_util.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+#include <cerrno>
+#include <stdexcept>
+
+namespace spi_eak {
+
+SpidevTransport::SpidevTransport(const std::string& device)
+    : fd_(::open(device.c_str(), O_RDWR)) {
+    if (fd_ < 0) {
+        const int err = errno;
+        throw std::runtime_error("Failed to open SPI device '" + device + "': " + detail::errnoMessage(err));
+    }
+}
+
+SpidevTransport::~SpidevTransport() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+int SpidevTransport::message(spi_ioc_transfer* ops, std::size_t count) {
+    return ioctl(fd_, SPI_IOC_MESSAGE(count), ops);
+}
+
+int SpidevTransport::writeMode(uint8_t mode) {
+    return ioctl(fd_, SPI_IOC_WR_MODE, &mode);
+}
+
+int SpidevTransport::writeBitsPerWord(uint8_t bits) {
+    return ioctl(fd_, SPI_IOC_WR_BITS_PER_WORD, &bits);
+}
+
+int SpidevTransport::writeMaxSpeed(uint32_t hz) {
+    return ioctl(fd_, SPI_IOC_WR_MAX_SPEED_HZ, &hz);
+}
+
+std::size_t SpidevTransport::bufferSize() const {
+    return SPI::driverBufferSize();
+}
+
+} // namespace spi_eak
@@ -0,0 +1,68 @@
+#ifndef SPI_TRANSPORT_H
+#define SPI_TRANSPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct spi_ioc_transfer;
+
+namespace spi_eak {
+
+/**
+ * The device operations SPI needs, shaped after the spidev ioctls they
+ * stand in for. Every call returns -1 with errno set on failure, so SPI
+ * reports transport errors exactly like kernel ones.
+ *
+ * SpidevTransport is the real device; SimulatedSpiDevice (sim_spi.h) runs
+ * the same calls against an in-process timing model.
+ */
+class SpiTransport {
+public:
+    virtual ~SpiTransport() = default;
+
+    /**
+     * SPI_IOC_MESSAGE(count): run `count` transfers in one CS assertion.
+     * Returns the number of bytes clocked.
+     */
+    virtual int message(spi_ioc_transfer* ops, std::size_t count) = 0;
+
+    virtual int writeMode(uint8_t mode) = 0;            // SPI_IOC_WR_MODE
+    virtual int writeBitsPerWord(uint8_t bits) = 0;     // SPI_IOC_WR_BITS_PER_WORD
+    virtual int writeMaxSpeed(uint32_t hz) = 0;         // SPI_IOC_WR_MAX_SPEED_HZ
+
+    /**
+     * Largest message, in bytes per direction, that message() accepts.
+     */
+    [[nodiscard]] virtual std::size_t bufferSize() const = 0;
+};
+
+/**
+ * A /dev/spidevB.C node opened read/write.
+ */
+class SpidevTransport : public SpiTransport {
+public:
+    /**
+     * Throws std::runtime_error when the node cannot be opened.
+     */
+    explicit SpidevTransport(const std::string& device);
+    ~SpidevTransport() override;
+
+    SpidevTransport(const SpidevTransport&) = delete;
+    SpidevTransport& operator=(const SpidevTransport&) = delete;
+
+    int message(spi_ioc_transfer* ops, std::size_t count) override;
+    int writeMode(uint8_t mode) override;
+    int writeBitsPerWord(uint8_t bits) override;
+    int writeMaxSpeed(uint32_t hz) override;
+    [[nodiscard]] std::size_t bufferSize() const override;
+
+    [[nodiscard]] int fd() const noexcept { return fd_; }
+
+private:
+    int fd_ = -1;
+};
+
+} // namespace spi_eak
+
+#endif // SPI_TRANSPORT_H
@@ -0,0 +1,132 @@
+#include "stream_transfer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <stdexcept>
+
+namespace spi_eak {
+
+namespace {
+
+AsyncSPI::Options engineOptions(const StreamTransfer::Options& options) {
+    AsyncSPI::Options engine;
+    engine.queue_depth = 2;
+    engine.io_thread = options.io_thread;
+    return engine;
+}
+
+} // namespace
+
+StreamTransfer::StreamTransfer(SPI& spi, const Options& options)
+    : spi_(spi)
+    , chunking_(options.chunking)
+    , message_bytes_(options.message_bytes ? options.message_bytes : spi.messageLimit())
+    , engine_([this](uint8_t* rx, const uint8_t* tx, std::size_t length) {
+                  sendMessage(rx, tx, length);
+              },
+              engineOptions(options)) {
+    for (int slot = 0; slot < 2; ++slot) {
+        tx_[slot].resize(message_bytes_);
+        rx_[slot].resize(message_bytes_);
+    }
+}
+
+StreamTransfer::StreamTransfer(SPI& spi)
+    : StreamTransfer(spi, Options{}) {}
+
+void StreamTransfer::sendMessage(uint8_t* rx, const uint8_t* tx, std::size_t length) {
+    SPI::ChunkOptions chunking = chunking_;
+    stream_sent_ += length;
+    // Keep CS asserted between messages so the peer sees one transaction.
+    chunking.leave_cs_asserted = chunking_.hold_cs && stream_sent_ < stream_total_;
+    spi_.transferChunked(rx, tx, length, chunking);
+}
+
+void StreamTransfer::run(std::size_t total_bytes, const Producer& producer, const Consumer& consumer) {
+    if (total_bytes == 0) {
+        return;
+    }
+    // The I/O thread is idle between runs, and the submission ring publishes
+    // these before the first message executes.
+    stream_total_ = total_bytes;
+    stream_sent_ = 0;
+
+    std::future<void> pending[2];
+    std::size_t pending_offset[2] = {0, 0};
+    std::size_t pending_length[2] = {0, 0};
+    std::exception_ptr failure;
+
+    auto retire = [&](int slot) {
+        if (!pending[slot].valid()) {
+            return;
+        }
+        try {
+            pending[slot].get();
+            if (consumer && !failure) {
+                consumer(rx_[slot].data(), pending_offset[slot], pending_length[slot]);
+            }
+        } catch (...) {
+            if (!failure) {
+                failure = std::current_exception();
+            }
+        }
+    };
+
+    std::size_t offset = 0;
+    int slot = 0;
+    while (offset < total_bytes && !failure) {
+        retire(slot);
+        if (failure) {
+            break;
+        }
+        const std::size_t length = std::min(message_bytes_, total_bytes - offset);
+        try {
+            if (producer) {
+                producer(tx_[slot].data(), offset, length);
+            } else {
+                std::memset(tx_[slot].data(), 0, length);
+            }
+        } catch (...) {
+            // Stop feeding but still wait for the message already on the bus.
+            failure = std::current_exception();
+            break;
+        }
+        pending_offset[slot] = offset;
+        pending_length[slot] = length;
+        pending[slot] = engine_.submitFuture(tx_[slot].data(), rx_[slot].data(), length);
+        offset += length;
+        slot ^= 1;
+    }
+
+    // Drain in submission order so RX is consumed sequentially.
+    retire(slot);
+    retire(slot ^ 1);
+    if (failure) {
+        // The I/O thread is idle once both futures are retired.
+        releaseChipSelect();
+        std::rethrow_exception(failure);
+    }
+}
+
+void StreamTransfer::releaseChipSelect() noexcept {
+    // Only an aborted hold_cs stream can have left CS asserted: every
+    // message but the last one keeps it, and the last one never went out.
+    if (!chunking_.hold_cs || stream_sent_ == 0 || stream_sent_ >= stream_total_) {
+        return;
+    }
+    // One fill byte with CS dropped afterwards ends the transaction, so the
+    // peer and other devices on the controller are not left mid-stream.
+    SPI::ChunkOptions closing = chunking_;
+    closing.leave_cs_asserted = false;
+    uint8_t tx = 0;
+    uint8_t rx = 0;
+    try {
+        spi_.transferChunked(&rx, &tx, 1, closing);
+    } catch (...) {
+        // The original failure is the one worth reporting.
+    }
+}
+
+} // namespace spi_eak
@@ -0,0 +1,70 @@
+#ifndef STREAM_TRANSFER_H
+#define STREAM_TRANSFER_H
+
+#include "async_spi.h"
+#include "spi.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace spi_eak {
+
+/**
+ * Double-buffered streaming for multi-megabyte transfers.
+ * The stream is cut into driver-sized messages; while message N is on the
+ * bus (on the AsyncSPI I/O thread), the caller's thread fills message N+1
+ * and consumes the RX of message N-1. With hold_cs the whole stream is one
+ * CS assertion.
+ */
+class StreamTransfer {
+public:
+    // Fill `length` TX bytes for stream offset `offset`.
+    using Producer = std::function<void(uint8_t* tx, std::size_t offset, std::size_t length)>;
+    // Consume `length` RX bytes received at stream offset `offset`.
+    using Consumer = std::function<void(const uint8_t* rx, std::size_t offset, std::size_t length)>;
+
+    struct Options {
+        std::size_t message_bytes = 0; // 0 -> SPI::messageLimit()
+        SPI::ChunkOptions chunking;    // per-message chunking; hold_cs spans the stream
+        ThreadPolicy io_thread;
+    };
+
+    /**
+     * `spi` must not be used by other threads while a stream is running.
+     */
+    StreamTransfer(SPI& spi, const Options& options);
+    explicit StreamTransfer(SPI& spi);
+
+    StreamTransfer(const StreamTransfer&) = delete;
+    StreamTransfer& operator=(const StreamTransfer&) = delete;
+
+    /**
+     * Clock `total_bytes` through the device. A null producer sends zeros, a
+     * null consumer discards RX. Rethrows the first producer, consumer or
+     * transfer error after the pipeline has drained; with hold_cs, a stream
+     * cut short is closed with one fill byte so CS is not left asserted.
+     */
+    void run(std::size_t total_bytes, const Producer& producer, const Consumer& consumer);
+
+    [[nodiscard]] std::size_t messageBytes() const noexcept { return message_bytes_; }
+
+private:
+    void sendMessage(uint8_t* rx, const uint8_t* tx, std::size_t length);
+    void releaseChipSelect() noexcept;
+
+    SPI& spi_;
+    SPI::ChunkOptions chunking_;
+    std::size_t message_bytes_;
+    std::vector<uint8_t> tx_[2];
+    std::vector<uint8_t> rx_[2];
+    // Touched only on the I/O thread while a stream runs.
+    std::size_t stream_total_ = 0;
+    std::size_t stream_sent_ = 0;
+    AsyncSPI engine_;
+};
+
+} // namespace spi_eak
+
+#endif // STREAM_TRANSFER_H
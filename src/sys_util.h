@@ -0,0 +1,35 @@
+#ifndef SYS_UTIL_H
+#define SYS_UTIL_H
+
+#include <time.h>
+
+#include <cstdint>
+#include <string>
+#include <system_error>
+
+namespace spi_eak {
+namespace detail {
+
+/**
+ * strerror-style text for an errno value, for exception messages.
+ */
+inline std::string errnoMessage(int err) {
+    return std::error_code(err, std::generic_category()).message();
+}
+
+constexpr uint64_t kNsPerSecond = 1'000'000'000;
+
+/**
+ * CLOCK_MONOTONIC in nanoseconds; the clock that timerfd, clock_nanosleep
+ * and GPIO event timestamps use.
+ */
+inline uint64_t monotonicNs() noexcept {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * kNsPerSecond + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+} // namespace detail
+} // namespace spi_eak
+
+#endif // SYS_UTIL_H
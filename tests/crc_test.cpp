@@ -0,0 +1,98 @@
+// Cross-checks every CRC kernel in crc.h against bit-at-a-time references
+// and the catalogue check values. Run with `make test`; exits 1 on the
+// first mismatch.
+
+#include "crc.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace spi_eak;
+
+namespace {
+
+int failures = 0;
+
+void expect(bool ok, const char* what, std::size_t length, std::size_t offset, uint32_t seed) {
+    if (!ok) {
+        std::fprintf(stderr, "FAIL %s (length %zu, offset %zu, seed 0x%08x)\n", what, length, offset, seed);
+        ++failures;
+    }
+}
+
+uint16_t crc16Bitwise(uint16_t crc, const uint8_t* data, std::size_t length) {
+    for (std::size_t idx = 0; idx < length; ++idx) {
+        crc = static_cast<uint16_t>(crc ^ (data[idx] << 8));
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1);
+        }
+    }
+    return crc;
+}
+
+uint32_t crc32cBitwise(uint32_t state, const uint8_t* data, std::size_t length) {
+    for (std::size_t idx = 0; idx < length; ++idx) {
+        state ^= data[idx];
+        for (int bit = 0; bit < 8; ++bit) {
+            state = (state & 1) ? (state >> 1) ^ 0x82F63B78 : state >> 1;
+        }
+    }
+    return state;
+}
+
+void checkValues() {
+    const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    expect(crc::crc16_ccitt(check, sizeof(check)) == 0x29B1, "crc16 check value", sizeof(check), 0, crc::kCrc16Init);
+    expect(crc::crc32c(check, sizeof(check)) == 0xE3069283, "crc32c check value", sizeof(check), 0, crc::kCrc32cInit);
+}
+
+void checkKernels() {
+    std::mt19937 rng(0x5eed);
+    std::vector<uint8_t> buffer(2000 + 8);
+    for (auto& byte : buffer) {
+        byte = static_cast<uint8_t>(rng());
+    }
+
+    for (std::size_t length = 0; length <= 2000; ++length) {
+        for (std::size_t offset = 0; offset < 3; ++offset) {
+            const uint8_t* data = buffer.data() + offset;
+            const uint16_t seed16 = (length % 4 == 0) ? crc::kCrc16Init : static_cast<uint16_t>(rng());
+            const uint32_t seed32 = (length % 4 == 0) ? crc::kCrc32cInit : static_cast<uint32_t>(rng());
+
+            const uint16_t want16 = crc16Bitwise(seed16, data, length);
+            expect(crc::crc16Bytewise(seed16, data, length) == want16, "crc16Bytewise", length, offset, seed16);
+            expect(crc::crc16SliceBy8(seed16, data, length) == want16, "crc16SliceBy8", length, offset, seed16);
+            expect(crc::crc16Clmul(seed16, data, length) == want16, "crc16Clmul", length, offset, seed16);
+            expect(crc::crc16Update(seed16, data, length) == want16, "crc16Update", length, offset, seed16);
+
+            const uint32_t want32 = crc32cBitwise(seed32, data, length);
+            expect(crc::crc32cSliceBy8(seed32, data, length) == want32, "crc32cSliceBy8", length, offset, seed32);
+            expect(crc::crc32cHardware(seed32, data, length) == want32, "crc32cHardware", length, offset, seed32);
+            expect(crc::crc32cUpdate(seed32, data, length) == want32, "crc32cUpdate", length, offset, seed32);
+
+            // Feeding the message in two pieces must match one pass.
+            const std::size_t split = length ? rng() % (length + 1) : 0;
+            const uint16_t split16 = crc::crc16Update(crc::crc16Update(seed16, data, split), data + split, length - split);
+            expect(split16 == want16, "crc16Update split", length, offset, seed16);
+            const uint32_t split32 =
+                crc::crc32cUpdate(crc::crc32cUpdate(seed32, data, split), data + split, length - split);
+            expect(split32 == want32, "crc32cUpdate split", length, offset, seed32);
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    checkValues();
+    checkKernels();
+    if (failures > 0) {
+        std::fprintf(stderr, "crc_test: %d failures\n", failures);
+        return EXIT_FAILURE;
+    }
+    std::printf("crc_test: crc16 engine %s, crc32c engine %s: ok\n", crc::engineName(crc::crc16Engine()),
+                crc::engineName(crc::crc32cEngine()));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,193 @@
+// Streams a capture recorded with SPI::attachCapture through FrameDecoder,
+// either as fast as possible (decoder benchmarking) or with the original
+// inter-transfer timing.
+
+#include "capture.h"
+#include "link_layer.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace spi_eak;
+
+namespace {
+
+void usage(const char* argv0) {
+    std::cerr << "usage: " << argv0 << " [options] capture.bin\n"
+              << "  --tx              decode the TX direction instead of RX\n"
+              << "  --channel N       only replay records tagged with channel N\n"
+              << "  --timing          honour the original inter-transfer timing\n"
+              << "  --loops N         replay the capture N times (default 1)\n"
+              << "  --crc32c          frames carry a CRC-32C trailer\n"
+              << "  --no-crc          frames carry no checksum\n"
+              << "  --compressed      frames carry a compression flag byte\n"
+              << "  --cobs            frames use COBS instead of SLIP-style escaping\n"
+              << "  --max-frame N     decoder max_frame_bytes (default 2048)\n"
+              << "  --start/--stop/--escape 0xNN   framing sentinels\n"
+              << "  --drops           print every dropped frame with its record time\n";
+}
+
+const char* dropName(FrameDecoder::Result::DropReason reason) {
+    switch (reason) {
+        case FrameDecoder::Result::DropReason::TooShortForCrc:
+            return "too-short-for-crc";
+        case FrameDecoder::Result::DropReason::CrcMismatch:
+            return "crc-mismatch";
+        case FrameDecoder::Result::DropReason::FrameTooLarge:
+            return "frame-too-large";
+        case FrameDecoder::Result::DropReason::PoolExhausted:
+            return "pool-exhausted";
+        case FrameDecoder::Result::DropReason::DecompressFailed:
+            return "decompress-failed";
+        case FrameDecoder::Result::DropReason::Malformed:
+            return "malformed";
+        case FrameDecoder::Result::DropReason::None:
+            break;
+    }
+    return "none";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool use_tx = false;
+    bool timing = false;
+    bool print_drops = false;
+    long channel = -1;
+    unsigned long loops = 1;
+    FrameDecoder::Options decoder_opts;
+    std::string path;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> unsigned long {
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                std::exit(2);
+            }
+            return std::strtoul(argv[++i], nullptr, 0);
+        };
+        if (arg == "--tx") {
+            use_tx = true;
+        } else if (arg == "--timing") {
+            timing = true;
+        } else if (arg == "--drops") {
+            print_drops = true;
+        } else if (arg == "--channel") {
+            channel = static_cast<long>(value());
+        } else if (arg == "--loops") {
+            loops = value();
+        } else if (arg == "--crc32c") {
+            decoder_opts.params.checksum = FrameCodec::Checksum::Crc32C;
+        } else if (arg == "--no-crc") {
+            decoder_opts.params.enable_crc16 = false;
+        } else if (arg == "--cobs") {
+            decoder_opts.params.framing = FrameCodec::Framing::Cobs;
+        } else if (arg == "--compressed") {
+            // Any method decodes; the flag byte in each frame names it.
+            decoder_opts.params.compression = FrameCodec::Compression::Lz;
+        } else if (arg == "--max-frame") {
+            decoder_opts.max_frame_bytes = value();
+        } else if (arg == "--start") {
+            decoder_opts.params.start_byte = static_cast<uint8_t>(value());
+        } else if (arg == "--stop") {
+            decoder_opts.params.stop_byte = static_cast<uint8_t>(value());
+        } else if (arg == "--escape") {
+            decoder_opts.params.escape_byte = static_cast<uint8_t>(value());
+        } else if (!arg.empty() && arg[0] != '-' && path.empty()) {
+            path = arg;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (path.empty()) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    try {
+        CaptureReader reader(path);
+        FrameDecoder decoder(decoder_opts);
+        std::vector<uint8_t> frame;
+        frame.reserve(decoder_opts.max_frame_bytes);
+
+        uint64_t records = 0;
+        uint64_t bytes = 0;
+        uint64_t frames = 0;
+        uint64_t payload_bytes = 0;
+        uint64_t drops[LinkMetrics::kDropReasons] = {};
+        uint64_t record_time = 0;
+
+        const auto on_result = [&](const FrameDecoder::Result& result) {
+            if (result.frame_ready) {
+                ++frames;
+                payload_bytes += frame.size();
+                return;
+            }
+            ++drops[static_cast<std::size_t>(result.drop_reason)];
+            if (print_drops) {
+                std::cout << "drop " << dropName(result.drop_reason) << " in record " << records
+                          << " at +" << (record_time - reader.header().start_monotonic_ns) / 1000
+                          << " us\n";
+            }
+        };
+
+        const auto started = std::chrono::steady_clock::now();
+        for (unsigned long loop = 0; loop < loops; ++loop) {
+            reader.rewind();
+            decoder.reset();
+            CaptureReader::Record record;
+            uint64_t first_timestamp = 0;
+            const auto loop_started = std::chrono::steady_clock::now();
+            while (reader.next(record)) {
+                const uint8_t* data = use_tx ? record.tx : record.rx;
+                if (!data || (channel >= 0 && record.channel != channel)) {
+                    continue;
+                }
+                if (timing) {
+                    if (first_timestamp == 0) {
+                        first_timestamp = record.timestamp_ns;
+                    }
+                    std::this_thread::sleep_until(
+                        loop_started + std::chrono::nanoseconds(record.timestamp_ns - first_timestamp));
+                }
+                record_time = record.timestamp_ns;
+                decoder.decode(data, record.length, frame, on_result);
+                ++records;
+                bytes += record.length;
+            }
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        uint64_t total_drops = 0;
+        for (uint64_t count : drops) {
+            total_drops += count;
+        }
+        std::cout << "records:  " << records << " (" << bytes << " bytes)\n"
+                  << "frames:   " << frames << " (" << payload_bytes << " payload bytes)\n"
+                  << "dropped:  " << total_drops << "\n";
+        for (std::size_t idx = 1; idx < LinkMetrics::kDropReasons; ++idx) {
+            if (drops[idx]) {
+                std::cout << "  " << dropName(static_cast<FrameDecoder::Result::DropReason>(idx)) << ": "
+                          << drops[idx] << "\n";
+            }
+        }
+        std::cout << std::fixed << std::setprecision(3) << "elapsed:  " << seconds << " s";
+        if (!timing && seconds > 0) {
+            std::cout << " (" << std::setprecision(1) << static_cast<double>(bytes) / seconds / 1e6
+                      << " MB/s)";
+        }
+        std::cout << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}